@@ -14,6 +14,9 @@
 #include "EnhancedInputSubsystems.h"
 #include "InputActionValue.h"
 #include "TriggerSpace.h"
+#include "MazeFlowFieldSubsystem.h"
+#include "CharacterIndexSubsystem.h"
+#include "PerceptionSubsystem.h"
 #include "Net/UnrealNetwork.h"
 
 DEFINE_LOG_CATEGORY(LogTemplateCharacter);
@@ -33,6 +36,24 @@ bool AAbyssTunnelsCharacter::IsInAttackRangeOfTarget() const
 	 return GetDistSquaredFromActiveTarget() <= AttackRange;
 }
 
+bool AAbyssTunnelsCharacter::MoveAlongFlowFieldToTarget(const float ScaleValue)
+{
+	if (!AttentionTarget)
+	{
+		return false;
+	}
+	if (const UMazeFlowFieldSubsystem* FlowFields = GetWorld()->GetSubsystem<UMazeFlowFieldSubsystem>())
+	{
+		const FVector Direction = FlowFields->GetFlowDirection(GetActorLocation(), AttentionTarget);
+		if (!Direction.IsZero())
+		{
+			AddMovementInput(Direction, ScaleValue);
+			return true;
+		}
+	}
+	return false;
+}
+
 bool AAbyssTunnelsCharacter::GetIsAttackable()
 {
 	if (!IsPlayerControlled())
@@ -57,23 +78,16 @@ bool AAbyssTunnelsCharacter::GetIsAttackable()
 bool AAbyssTunnelsCharacter::GetTargetableCharacters(TArray<AAbyssTunnelsCharacter*>& OutTargetableCharacters) const
 {
 	bool bTargetableCharacterFound = false;
-	if (UWorld* World = GetWorld())
+	if (UCharacterIndexSubsystem* CharacterIndex = UCharacterIndexSubsystem::Get(this))
 	{
-		for (FConstPlayerControllerIterator Iterator = World->GetPlayerControllerIterator(); Iterator; ++Iterator)
+		const FCharacterSnapshot& Snapshot = CharacterIndex->GetSnapshot();
+		for (const int32 Entry : Snapshot.PlayerEntries)
 		{
-			APlayerController* PlayerController = Iterator->Get();
-			if (PlayerController == nullptr || PlayerController->Player == nullptr)
+			AAbyssTunnelsCharacter* Pawn = Snapshot.Characters[Entry];
+			if (Pawn->GetIsAttackable())
 			{
-				continue;
-			}
-
-			if (AAbyssTunnelsCharacter* Pawn = Cast<AAbyssTunnelsCharacter>(PlayerController->GetPawn()))
-			{
-				if (Pawn->GetIsAttackable())
-				{
-					OutTargetableCharacters.Add(Pawn);
-					bTargetableCharacterFound = true;
-				}
+				OutTargetableCharacters.Add(Pawn);
+				bTargetableCharacterFound = true;
 			}
 		}
 	}
@@ -145,6 +159,10 @@ void AAbyssTunnelsCharacter::BeginPlay()
 	{
 		PlayerController->Characters.Add(this);
 	}
+	if (UCharacterIndexSubsystem* CharacterIndex = UCharacterIndexSubsystem::Get(this))
+	{
+		CharacterIndex->RegisterCharacter(this);
+	}
 }
 
 void AAbyssTunnelsCharacter::HandleOverlap(AActor* OverlappedActor, AActor* OtherActor)
@@ -164,6 +182,10 @@ void AAbyssTunnelsCharacter::EndPlay(const EEndPlayReason::Type EndPlayReason)
 	{
 		PlayerController->Characters.Remove(this);
 	}
+	if (UCharacterIndexSubsystem* CharacterIndex = UCharacterIndexSubsystem::Get(this))
+	{
+		CharacterIndex->UnregisterCharacter(this);
+	}
 	Super::EndPlay(EndPlayReason);
 }
 
@@ -240,50 +262,64 @@ void AAbyssTunnelsCharacter::Look(const FInputActionValue& Value)
 
 void AAbyssTunnelsCharacter::UpdatePlayerSeeing()
 {
+	// the perception subsystem already keeps this up to date on the server.
+	if (UPerceptionSubsystem::IsEnabled() && HasAuthority())
+	{
+		return;
+	}
 	bIsSeenByPlayer = false;
 	SeenCharacters.Empty();
-	if (UWorld* World = GetWorld())
+	UCharacterIndexSubsystem* CharacterIndex = UCharacterIndexSubsystem::Get(this);
+	if (!CharacterIndex)
+	{
+		return;
+	}
+	const FCharacterSnapshot& Snapshot = CharacterIndex->GetSnapshot();
+	const FVector Location = GetActorLocation();
+	const FVector Forward = GetActorForwardVector();
+	for (const int32 Entry : Snapshot.PlayerEntries)
 	{
-		for (FConstPlayerControllerIterator Iterator = World->GetPlayerControllerIterator(); Iterator; ++Iterator)
+		AAbyssTunnelsCharacter* Character = Snapshot.Characters[Entry];
+		if (Character == this)
 		{
-			APlayerController* PlayerController = Iterator->Get();
-			if (PlayerController == nullptr || PlayerController->Player == nullptr)
-			{
-				continue;
-			}
-			if (AAbyssTunnelsCharacter* Character = Cast<AAbyssTunnelsCharacter>(PlayerController->GetCharacter()))
-			{
-				FHitResult Hit;
-				if (GetWorld()->LineTraceSingleByChannel(Hit, GetActorLocation(), Character->GetActorLocation(), ECC_GameTraceChannel1)) // environment channel
-				{
-					continue; // there is no seeing through walls
-				}
-				if (UAbyssTunnelsGameplayStatics::IsCharacterFacing(this, Character))
-				{
-					SeenCharacters.AddUnique(Character);
-				}
-				if (UAbyssTunnelsGameplayStatics::IsCharacterFacing(Character, this))
-				{
-					bIsSeenByPlayer = true;
-				}
-			}
+			continue;
+		}
+		const FVector ToCharacter = Snapshot.GetLocation(Entry) - Location;
+		const bool bFacingCharacter = UAbyssTunnelsGameplayStatics::IsFacing(Forward, ToCharacter);
+		const bool bCharacterFacingUs = UAbyssTunnelsGameplayStatics::IsFacing(Snapshot.GetForward(Entry), -ToCharacter);
+		// nobody is looking at anybody so there is nothing a trace could change.
+		if (!bFacingCharacter && !bCharacterFacingUs)
+		{
+			continue;
+		}
+		if (!UAbyssTunnelsGameplayStatics::HasLineOfSight(this, Location, Snapshot.GetLocation(Entry)))
+		{
+			continue; // there is no seeing through walls
+		}
+		if (bFacingCharacter)
+		{
+			SeenCharacters.AddUnique(Character);
+		}
+		if (bCharacterFacingUs)
+		{
+			bIsSeenByPlayer = true;
 		}
 	}
 }
 
 void AAbyssTunnelsCharacter::UpdateStealthEffectOnAllMaterials()
 {
+	const float StealthValue = bIsSeenByPlayer ? 0.f : 1.f;
+	if (bUseCustomPrimitiveDataForStealth)
+	{
+		// one write covers every material slot on the mesh.
+		Mesh->SetCustomPrimitiveDataFloat(StealthCustomDataIndex, StealthValue);
+		return;
+	}
 	const FName MaterialStealthParamName = FName(TEXT("OpacityMultiplier"));
 	for (UMaterialInstanceDynamic* Material : DynamicMaterials)
 	{
-		if (bIsSeenByPlayer)
-		{
-			Material->SetScalarParameterValue(MaterialStealthParamName, 0.f);
-		}
-		else
-		{
-			Material->SetScalarParameterValue(MaterialStealthParamName, 1.f);
-		}
+		Material->SetScalarParameterValue(MaterialStealthParamName, StealthValue);
 	}
 }
 
@@ -310,6 +346,12 @@ void AAbyssTunnelsCharacter::OnRep_bIsSeenByPlayer()
 
 void AAbyssTunnelsCharacter::ConvertMaterialsToDynamic()
 {
+	if (bUseCustomPrimitiveDataForStealth)
+	{
+		// materials stay shared, just make sure the mesh starts out with the right value.
+		UpdateStealthEffectOnAllMaterials();
+		return;
+	}
 	int TotalMaterials = Mesh->GetNumMaterials();
 	for (int i = 0; i < TotalMaterials; ++i)
 	{
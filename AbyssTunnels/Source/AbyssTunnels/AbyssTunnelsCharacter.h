@@ -40,6 +40,11 @@ public:
 	UFUNCTION(BlueprintPure)
 	bool GetIsAttackable();
 
+	// steers towards AttentionTarget along the shared maze flow field (server only). returns false when there is
+	// no field for the target, e.g. it isn't a player, so the caller can fall back to a regular move to.
+	UFUNCTION(BlueprintCallable, Category = "Abyss")
+	bool MoveAlongFlowFieldToTarget(const float ScaleValue = 1.f);
+
 	UFUNCTION(BlueprintPure)
 	bool GetTargetableCharacters(TArray<AAbyssTunnelsCharacter*>& OutTargetableCharacters) const;
 
@@ -120,6 +125,16 @@ public:
 	/** Returns FollowCamera subobject **/
 	FORCEINLINE class UCameraComponent* GetFollowCamera() const { return FollowCamera; }
 
+	// drive OpacityMultiplier through the mesh's custom primitive data instead of a dynamic instance per material
+	// slot. the materials have to expose OpacityMultiplier as custom primitive data at StealthCustomDataIndex, so
+	// only turn this on in a blueprint once its materials have been converted.
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Abyss")
+	bool bUseCustomPrimitiveDataForStealth = false;
+
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Abyss", meta = (ClampMin = "0"))
+	int StealthCustomDataIndex = 0;
+
+	// with custom primitive data this only pushes the current stealth value, no material instances get made.
 	UFUNCTION(BlueprintCallable)
 	void ConvertMaterialsToDynamic();
 	
@@ -3,6 +3,7 @@
 #include "AbyssTunnelsGameMode.h"
 #include "AbyssTunnelsGameState.h"
 #include "AbyssTunnelsPlayerController.h"
+#include "ActorPoolComponent.h"
 #include "GameFramework/GameModeBase.h"
 #include "GameFramework/GameSession.h"
 #include "UObject/ConstructorHelpers.h"
@@ -11,6 +12,7 @@ AAbyssTunnelsGameMode::AAbyssTunnelsGameMode()
 {
 	PlayerControllerClass = AAbyssTunnelsPlayerController::StaticClass();
 	GameStateClass = AAbyssTunnelsGameState::StaticClass();
+	ActorPool = CreateDefaultSubobject<UActorPoolComponent>(TEXT("ActorPool"));
 	static ConstructorHelpers::FClassFinder<ABoardGenerator> BoardClass(TEXT("/Game/ThirdPerson/Blueprints/BP_Board"));
 	if (BoardClass.Class != NULL)
 	{
@@ -24,10 +26,17 @@ AAbyssTunnelsGameMode::AAbyssTunnelsGameMode()
 
 void AAbyssTunnelsGameMode::SpawnNewGameBoard(const int Level, const bool bParamIsAscending)
 {
+	// the old board already picked (and most likely built) a seed for the level it expected to come next.
+	FMapLevelData PredictedLevelData;
 	if (CurrentBoard)
 	{
-		CurrentBoard->Destroy();
-		CurrentBoard = nullptr;
+		PredictedLevelData = CurrentBoard->NextMapLevelData;
+		// a recycling board is kept and rebuilt in place so it can reuse its instances.
+		if (!CurrentBoard->bRecycleInstances)
+		{
+			CurrentBoard->Destroy();
+			CurrentBoard = nullptr;
+		}
 	}
 
 	if (UWorld* World = GetWorld())
@@ -45,10 +54,15 @@ void AAbyssTunnelsGameMode::SpawnNewGameBoard(const int Level, const bool bParam
 				Pawn->Destroy();
 			}
 		}
+		if (CurrentBoard)
+		{
+			CurrentBoard->InitializeMap(Level, bParamIsAscending, PredictedLevelData);
+			return;
+		}
 		UE_LOG(LogTemp, Warning, TEXT("Spawning game board from %s"), *BoardGenClass->GetName());
 		if (ABoardGenerator* NewBoard = Cast<ABoardGenerator>(World->SpawnActor(BoardGenClass)))
 		{
-			NewBoard->InitializeMap(Level, bParamIsAscending);
+			NewBoard->InitializeMap(Level, bParamIsAscending, PredictedLevelData);
 			CurrentBoard = NewBoard;
 		}
 	}
@@ -7,6 +7,8 @@
 #include "BoardGenerator.h"
 #include "AbyssTunnelsGameMode.generated.h"
 
+class UActorPoolComponent;
+
 UCLASS(minimalapi)
 class AAbyssTunnelsGameMode : public AGameMode
 {
@@ -28,4 +30,8 @@ public:
 
 	UPROPERTY(Transient)
 	TObjectPtr<ABoardGenerator> CurrentBoard;
+
+	// lives here rather than on the board since boards get replaced every level.
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+	TObjectPtr<UActorPoolComponent> ActorPool;
 };
@@ -3,11 +3,17 @@
 
 #include "AbyssTunnelsGameState.h"
 #include "AbyssTunnelsGameMode.h"
+#include "DecalManagerComponent.h"
 #include "Components/CapsuleComponent.h"
 #include "GameFramework/PlayerController.h"
 #include "Net/UnrealNetwork.h"
 
 
+AAbyssTunnelsGameState::AAbyssTunnelsGameState()
+{
+	DecalManager = CreateDefaultSubobject<UDecalManagerComponent>(TEXT("DecalManager"));
+}
+
 void AAbyssTunnelsGameState::BeginPlay()
 {
 	Super::BeginPlay();
@@ -48,3 +54,26 @@ AAbyssTunnelsGameState* AAbyssTunnelsGameState::Get(const UObject* WorldContextO
 	UWorld* const World = GEngine->GetWorldFromContextObject(WorldContextObject, EGetWorldErrorMode::LogAndReturnNull);
 	return World ? Cast<AAbyssTunnelsGameState>(World->GetGameState()) : nullptr;
 }
+
+void AAbyssTunnelsGameState::StorePreparedLayout(const FMazeBuildParams& Params, const TSharedRef<FMazeLayout, ESPMode::ThreadSafe>& Layout)
+{
+	// finished after its transition (or a newer prediction replaced it), nobody is going to take it.
+	const ABoardGenerator* Board = CurrentBoard.Get();
+	if (!Board || Board->NextMapLevelData.Level != Params.LevelData.Level || Board->NextMapLevelData.Seed != Params.LevelData.Seed)
+	{
+		return;
+	}
+	PreparedParams = Params;
+	PreparedLayout = Layout;
+}
+
+TSharedPtr<FMazeLayout, ESPMode::ThreadSafe> AAbyssTunnelsGameState::TakePreparedLayout(const FMazeBuildParams& Params)
+{
+	if (!PreparedLayout.IsValid())
+	{
+		return nullptr;
+	}
+	// either way it is of no use to anyone after this.
+	TSharedPtr<FMazeLayout, ESPMode::ThreadSafe> Layout = MoveTemp(PreparedLayout);
+	return PreparedParams.BuildsSameLayout(Params) ? Layout : nullptr;
+}
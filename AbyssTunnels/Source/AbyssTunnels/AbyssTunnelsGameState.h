@@ -9,12 +9,14 @@
 #include "AbyssTunnelsGameState.generated.h"
 
 class APlayerController;
+class UDecalManagerComponent;
 
 UCLASS()
 class ABYSSTUNNELS_API AAbyssTunnelsGameState : public AGameState
 {
 	GENERATED_BODY()
 public:
+	AAbyssTunnelsGameState();
 	virtual void BeginPlay() override;
 
 	UPROPERTY(Replicated, EditAnywhere, BlueprintReadWrite)
@@ -26,4 +28,23 @@ public:
 	UFUNCTION(BlueprintPure, Category = "Game", meta = (WorldContext = "WorldContextObject"))
 	static AAbyssTunnelsGameState* Get(const UObject* WorldContextObject);
 
+	// boards get replaced every level so layouts built ahead of time are parked here until the next board asks for them.
+	// a layout is only kept while it is still for the current board's predicted next level, and only handed to a board
+	// whose build params would have built the exact same layout.
+	void StorePreparedLayout(const FMazeBuildParams& Params, const TSharedRef<FMazeLayout, ESPMode::ThreadSafe>& Layout);
+	TSharedPtr<FMazeLayout, ESPMode::ThreadSafe> TakePreparedLayout(const FMazeBuildParams& Params);
+
+	// the board currently in play, on server and clients alike.
+	void SetCurrentBoard(ABoardGenerator* Board) { CurrentBoard = Board; }
+	ABoardGenerator* GetCurrentBoard() const { return CurrentBoard.Get(); }
+
+	// the game state is always relevant and outlives the boards, so decals for everyone go through here.
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Abyss")
+	TObjectPtr<UDecalManagerComponent> DecalManager;
+
+protected:
+	TWeakObjectPtr<ABoardGenerator> CurrentBoard;
+	FMazeBuildParams PreparedParams;
+	TSharedPtr<FMazeLayout, ESPMode::ThreadSafe> PreparedLayout;
+
 };
@@ -2,3 +2,19 @@
 
 
 #include "AbyssTunnelsGameplayStatics.h"
+#include "AbyssTunnelsGameState.h"
+#include "BoardGenerator.h"
+
+bool UAbyssTunnelsGameplayStatics::HasLineOfSight(const UObject* WorldContextObject, const FVector& From, const FVector& To)
+{
+	if (const AAbyssTunnelsGameState* GameState = AAbyssTunnelsGameState::Get(WorldContextObject))
+	{
+		if (const ABoardGenerator* Board = GameState->GetCurrentBoard())
+		{
+			return Board->HasLineOfSight(From, To);
+		}
+	}
+	const UWorld* World = GEngine->GetWorldFromContextObject(WorldContextObject, EGetWorldErrorMode::LogAndReturnNull);
+	FHitResult Hit;
+	return World && !World->LineTraceSingleByChannel(Hit, From, To, ECC_GameTraceChannel1); // environment channel
+}
@@ -15,8 +15,17 @@ public:
 	UFUNCTION(BlueprintPure, Category = "AbyssTunnels")
 	static bool IsCharacterFacing(const AAbyssTunnelsCharacter* Character, const AActor* Target)
 	{
-		const FVector CharacterForwardVector = Character->GetActorForwardVector();
-		const FVector LookAtVector = Target->GetActorLocation() - Character->GetActorLocation();
-		return FVector::DotProduct(LookAtVector.GetUnsafeNormal(), CharacterForwardVector) > 0.2;
+		return IsFacing(Character->GetActorForwardVector(), Target->GetActorLocation() - Character->GetActorLocation());
+	}
+
+	// line of sight through the maze. goes through the current board's grid when there is one, otherwise it is
+	// a plain environment channel trace.
+	UFUNCTION(BlueprintPure, Category = "AbyssTunnels", meta = (WorldContext = "WorldContextObject"))
+	static bool HasLineOfSight(const UObject* WorldContextObject, const FVector& From, const FVector& To);
+
+	// same test on raw vectors, for code working off the character index snapshot.
+	static FORCEINLINE bool IsFacing(const FVector& ForwardVector, const FVector& LookAtVector)
+	{
+		return FVector::DotProduct(LookAtVector.GetUnsafeNormal(), ForwardVector) > 0.2;
 	}
 };
@@ -4,7 +4,7 @@
 #include "AbyssTunnelsPlayerController.h"
 #include "AbyssTunnelsGameMode.h"
 #include "AbyssTunnelsGameState.h"
-#include "Components/DecalComponent.h"
+#include "DecalManagerComponent.h"
 #include "Kismet/GameplayStatics.h"
 
 void AAbyssTunnelsPlayerController::BeginPlay()
@@ -52,24 +52,6 @@ AAbyssTunnelsCharacter* AAbyssTunnelsPlayerController::GetCharacter()
 	return Cast<AAbyssTunnelsCharacter>(GetPawn());
 }
 
-void AAbyssTunnelsPlayerController::MulticastSpawnDecalOnAllClients_Implementation(UMaterialInterface* DecalMaterial, const FVector& DecalSize,
-                                                                                   const FVector& InstanceLocation, const FRotator& InstanceRotation)
-{
-	if (UDecalComponent* Decal = UGameplayStatics::SpawnDecalAtLocation(this, DecalMaterial, DecalSize, InstanceLocation, InstanceRotation))
-	{
-		DecalComponents.Add(Decal);
-	}
-}
-
-void AAbyssTunnelsPlayerController::ClearAllDecals()
-{
-	for (auto* Decal : DecalComponents)
-	{
-		Decal->DestroyComponent();
-	}
-	DecalComponents.Empty();
-}
-
 void AAbyssTunnelsPlayerController::PickupItem(AEquipment* Equipment)
 {
 	if (Equipment && Equipments.Num() < MaxEquipmentSlots)
@@ -195,7 +177,10 @@ void AAbyssTunnelsPlayerController::ServerDropItem_Implementation(AEquipment* Eq
 
 void AAbyssTunnelsPlayerController::ServerSpawnDecalForAllClients_Implementation(UMaterialInterface* DecalMaterial, const FVector& DecalSize, const FVector& InstanceLocation, const FRotator& InstanceRotation)
 {
-	MulticastSpawnDecalOnAllClients(DecalMaterial, DecalSize, InstanceLocation, InstanceRotation);
+	if (UDecalManagerComponent* DecalManager = UDecalManagerComponent::Get(this))
+	{
+		DecalManager->AddDecal(DecalMaterial, DecalSize, InstanceLocation, InstanceRotation);
+	}
 }
 
 void AAbyssTunnelsPlayerController::ServerRespawnPawnForPlayerController_Implementation()
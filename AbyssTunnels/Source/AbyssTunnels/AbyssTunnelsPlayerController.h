@@ -45,12 +45,10 @@ public:
 	UFUNCTION(Server, Reliable, BlueprintCallable, Category = "Abyss")
 	void ServerRespawnPawnForPlayerController();
 
+	// hands the decal to the game state's UDecalManagerComponent which batches it out to everyone.
 	UFUNCTION(BlueprintCallable, Server, Reliable, Category = "Abyss")
 	void ServerSpawnDecalForAllClients(UMaterialInterface* DecalMaterial, const FVector& DecalSize, const FVector& InstanceLocation, const FRotator& InstanceRotation);
 
-	UFUNCTION(NetMulticast, Reliable, Category = "Abyss")
-	void MulticastSpawnDecalOnAllClients(UMaterialInterface* DecalMaterial, const FVector& DecalSize, const FVector& InstanceLocation, const FRotator& InstanceRotation);
-
 	// spawnable object's interaction method is called when user tries to interact with one of these items.
 	// they are NOT liftable/equippable, but are larger objects sitting around in the world.
 	UFUNCTION(BlueprintCallable, Server, Reliable, Category = "Abyss")
@@ -65,11 +63,6 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Abyss")
 	int MaxEquipmentSlots = 2;
 	
-	void ClearAllDecals();
-	
-	UPROPERTY(Transient)
-	TArray<UDecalComponent*> DecalComponents;
-
 	UPROPERTY(Transient)
 	TArray<AActor*> Characters;
 };
@@ -0,0 +1,133 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ActorPoolComponent.h"
+#include "PoolableActor.h"
+
+UActorPoolComponent::UActorPoolComponent()
+{
+	PrimaryComponentTick.bCanEverTick = false;
+}
+
+AActor* UActorPoolComponent::AcquireActor(TSubclassOf<AActor> ActorClass, const FTransform& Transform)
+{
+	UWorld* World = GetWorld();
+	if (!World || !ActorClass)
+	{
+		return nullptr;
+	}
+	if (FActorPoolBucket* Bucket = FreeActors.Find(ActorClass))
+	{
+		while (Bucket->Actors.Num() > 0)
+		{
+			AActor* Actor = Bucket->Actors.Pop(false);
+			if (!IsValid(Actor))
+			{
+				continue;
+			}
+			Actor->SetActorTransform(Transform, false, nullptr, ETeleportType::ResetPhysics);
+			Actor->SetActorHiddenInGame(false);
+			// back to what a fresh spawn of the class would have, some classes start with it off.
+			Actor->SetActorEnableCollision(Actor->GetClass()->GetDefaultObject<AActor>()->GetActorEnableCollision());
+			Actor->SetActorTickEnabled(Actor->PrimaryActorTick.bStartWithTickEnabled);
+			if (Actor->Implements<UPoolableActor>())
+			{
+				IPoolableActor::Execute_OnAcquiredFromPool(Actor);
+			}
+			// dormant actors still need to tell clients they're back.
+			Actor->FlushNetDormancy();
+			return Actor;
+		}
+	}
+	return World->SpawnActor<AActor>(ActorClass, Transform);
+}
+
+void UActorPoolComponent::ReleaseActor(AActor* Actor)
+{
+	if (!IsValid(Actor))
+	{
+		return;
+	}
+	FActorPoolBucket& Bucket = FreeActors.FindOrAdd(Actor->GetClass());
+	if (Bucket.Actors.Num() >= MaxFreePerClass)
+	{
+		Actor->Destroy();
+		return;
+	}
+	if (Actor->Implements<UPoolableActor>())
+	{
+		IPoolableActor::Execute_OnReturnedToPool(Actor);
+	}
+	Actor->DetachFromActor(FDetachmentTransformRules::KeepWorldTransform);
+	// equipment keeps the controller of whoever last held it as owner otherwise.
+	Actor->SetOwner(nullptr);
+	Actor->SetActorHiddenInGame(true);
+	Actor->SetActorEnableCollision(false);
+	Actor->SetActorTickEnabled(false);
+	Actor->FlushNetDormancy();
+	Bucket.Actors.Add(Actor);
+}
+
+void UActorPoolComponent::Prewarm(TSubclassOf<AActor> ActorClass, const int Count)
+{
+	UWorld* World = GetWorld();
+	if (!World || !ActorClass)
+	{
+		return;
+	}
+	FActorPoolBucket& Bucket = FreeActors.FindOrAdd(ActorClass);
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+	while (Bucket.Actors.Num() < FMath::Min(Count, MaxFreePerClass))
+	{
+		AActor* Actor = World->SpawnActor<AActor>(ActorClass, FTransform::Identity, SpawnParams);
+		if (!Actor)
+		{
+			break;
+		}
+		ReleaseActor(Actor);
+	}
+}
+
+int UActorPoolComponent::GetNumFree(TSubclassOf<AActor> ActorClass) const
+{
+	const FActorPoolBucket* Bucket = FreeActors.Find(ActorClass);
+	return Bucket ? Bucket->Actors.Num() : 0;
+}
+
+void UActorPoolComponent::EmptyPool()
+{
+	for (auto& Entry : FreeActors)
+	{
+		for (AActor* Actor : Entry.Value.Actors)
+		{
+			if (IsValid(Actor))
+			{
+				Actor->Destroy();
+			}
+		}
+	}
+	FreeActors.Empty();
+}
+
+void UActorPoolComponent::EmptyPoolOfClass(UClass* ActorClass)
+{
+	FActorPoolBucket Bucket;
+	if (!FreeActors.RemoveAndCopyValue(ActorClass, Bucket))
+	{
+		return;
+	}
+	for (AActor* Actor : Bucket.Actors)
+	{
+		if (IsValid(Actor))
+		{
+			Actor->Destroy();
+		}
+	}
+}
+
+void UActorPoolComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	EmptyPool();
+	Super::EndPlay(EndPlayReason);
+}
@@ -0,0 +1,56 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+#include "ActorPoolComponent.generated.h"
+
+USTRUCT()
+struct FActorPoolBucket
+{
+	GENERATED_BODY()
+
+	UPROPERTY(Transient)
+	TArray<TObjectPtr<AActor>> Actors;
+};
+
+// keeps actors around between levels instead of destroying and respawning them.
+// pooled actors are hidden with collision and tick off, they keep their net channel.
+UCLASS(ClassGroup=(Abyss), meta=(BlueprintSpawnableComponent))
+class ABYSSTUNNELS_API UActorPoolComponent : public UActorComponent
+{
+	GENERATED_BODY()
+
+public:
+	UActorPoolComponent();
+
+	// reuses a free actor of exactly this class if there is one, otherwise spawns a new one.
+	UFUNCTION(BlueprintCallable, Category = "Abyss")
+	AActor* AcquireActor(TSubclassOf<AActor> ActorClass, const FTransform& Transform);
+
+	UFUNCTION(BlueprintCallable, Category = "Abyss")
+	void ReleaseActor(AActor* Actor);
+
+	// spawns actors straight into the pool so the first level that needs them doesn't have to.
+	UFUNCTION(BlueprintCallable, Category = "Abyss")
+	void Prewarm(TSubclassOf<AActor> ActorClass, const int Count);
+
+	UFUNCTION(BlueprintPure, Category = "Abyss")
+	int GetNumFree(TSubclassOf<AActor> ActorClass) const;
+
+	void EmptyPool();
+
+	// destroys the free actors of exactly this class, for classes nothing is going to ask for again.
+	void EmptyPoolOfClass(UClass* ActorClass);
+
+	// anything released past this many free actors of one class just gets destroyed.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Abyss")
+	int MaxFreePerClass = 256;
+
+protected:
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	UPROPERTY(Transient)
+	TMap<TObjectPtr<UClass>, FActorPoolBucket> FreeActors;
+};
@@ -1,16 +1,43 @@
 
 #include "BoardGenerator.h"
 #include "AbyssTunnelsGameState.h"
+#include "AbyssTunnelsGameMode.h"
+#include "ActorPoolComponent.h"
+#include "MazeFlowFieldSubsystem.h"
+#include "MonsterSpawnDirector.h"
+#include "SpawnClassPreloader.h"
+#include "CharacterIndexSubsystem.h"
+#include "DecalManagerComponent.h"
 #include "AbyssTunnelsCharacter.h"
 #include "AbyssTunnelsPlayerController.h"
 #include "MapLevelData.h"
 #include "Net/UnrealNetwork.h"
 #include "SpawnDataAsset.h"
+#include "Async/Async.h"
 #include <Runtime/AIModule/Classes/AIController.h>
 
 #include "DetailLayoutBuilder.h"
 #include "SpawnTableEntry.h"
+#include "ItemSpawnPlanner.h"
 #include "Components/InstancedStaticMeshComponent.h"
+#include "Components/HierarchicalInstancedStaticMeshComponent.h"
+
+static TAutoConsoleVariable<bool> CVarGridLineOfSight(
+	TEXT("Abyss.GridLineOfSight"),
+	true,
+	TEXT("Answer line of sight checks from the maze grid where possible instead of always doing a physics trace."));
+
+// only here to compare instance commit times against the old one instance at a time path.
+static TAutoConsoleVariable<bool> CVarWallCommitPerInstance(
+	TEXT("Abyss.WallCommitPerInstance"),
+	false,
+	TEXT("Commit maze walls with one AddInstance call per wall instead of one bulk add per variant."));
+
+// used physical memory of the whole process right now, for the phase deltas in FLevelBuildStats.
+static int64 GetUsedPhysicalBytes()
+{
+	return int64(FPlatformMemory::GetStats().UsedPhysical);
+}
 
 ABoardGenerator::ABoardGenerator()
 {
@@ -40,27 +67,72 @@ void ABoardGenerator::BeginPlay()
 {
 	SetActorTickEnabled(false);
 	Super::BeginPlay();
+	if (AAbyssTunnelsGameState* GameState = AAbyssTunnelsGameState::Get(this))
+	{
+		GameState->SetCurrentBoard(this);
+	}
+	if (HasAuthority())
+	{
+		if (UActorPoolComponent* ActorPool = GetActorPool())
+		{
+			// every room can get a door on each side.
+			const int MaxDoors = CurrentMapLevelData.MaxRooms * 4;
+			// every level has doors so there's nothing to gain from streaming these.
+			ActorPool->Prewarm(DoorClass.LoadSynchronous(), MaxDoors);
+			ActorPool->Prewarm(DoorFrameClass.LoadSynchronous(), MaxDoors);
+		}
+	}
 }
 
-void ABoardGenerator::Tick(float DeltaSeconds)
+UActorPoolComponent* ABoardGenerator::GetActorPool() const
 {
-	Super::Tick(DeltaSeconds);
-	if (!HasAuthority())
+	if (const UWorld* World = GetWorld())
 	{
-		return;
+		if (const AAbyssTunnelsGameMode* GameMode = World->GetAuthGameMode<AAbyssTunnelsGameMode>())
+		{
+			return GameMode->ActorPool;
+		}
+	}
+	return nullptr;
+}
+
+AActor* ABoardGenerator::SpawnPooledActor(TSubclassOf<AActor> ActorClass, const FTransform& Transform)
+{
+	if (UActorPoolComponent* ActorPool = GetActorPool())
+	{
+		return ActorPool->AcquireActor(ActorClass, Transform);
 	}
+	return ActorClass ? GetWorld()->SpawnActor<AActor>(ActorClass, Transform) : nullptr;
+}
 
-	const int ConnectedPlayers = GetWorld()->GetNumPlayerControllers();
-	// this is responsible for spawning monsters gradually into the maze.
-	if (ActiveMonsters.Num() < (ConnectedPlayers + CurrentMapLevelData.MaximumMonsters()))
+void ABoardGenerator::ReleasePooledActor(AActor* Actor)
+{
+	UActorPoolComponent* ActorPool = GetActorPool();
+	// anything attached (equipment a player is holding) isn't ours to recycle.
+	if (ActorPool && !Actor->GetAttachParentActor())
+	{
+		ActorPool->ReleaseActor(Actor);
+	}
+	else
 	{
-		SpawnRandomMonster();
+		Actor->Destroy();
 	}
 }
 
 void ABoardGenerator::EndPlay(const EEndPlayReason::Type Reason)
 {
 	CleanupMazeContents();
+	if (USpawnClassPreloader* Preloader = USpawnClassPreloader::Get(this))
+	{
+		Preloader->ReleaseBoard(this);
+	}
+	if (AAbyssTunnelsGameState* GameState = AAbyssTunnelsGameState::Get(this))
+	{
+		if (GameState->GetCurrentBoard() == this)
+		{
+			GameState->SetCurrentBoard(nullptr);
+		}
+	}
 	Super::EndPlay(Reason);
 }
 
@@ -68,6 +140,7 @@ void ABoardGenerator::GetLifetimeReplicatedProps(TArray< FLifetimeProperty >& Ou
 {
 	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
 	DOREPLIFETIME(ABoardGenerator, CurrentMapLevelData);
+	DOREPLIFETIME(ABoardGenerator, NextMapLevelData);
 }
 
 void ABoardGenerator::OnRep_CurrentMapLevelData(FMapLevelData& OldMapLevelData)
@@ -82,6 +155,15 @@ void ABoardGenerator::OnRep_CurrentMapLevelData(FMapLevelData& OldMapLevelData)
 	HandleLevelChange();
 }
 
+void ABoardGenerator::OnRep_NextMapLevelData()
+{
+	PreloadReachableLevels();
+	if (bPrebuildNextLevel)
+	{
+		PrebuildNextLevel();
+	}
+}
+
 void ABoardGenerator::HandleLevelChange()
 {
 	if (AAbyssTunnelsGameState* GameState = AAbyssTunnelsGameState::Get(this))
@@ -94,36 +176,215 @@ void ABoardGenerator::HandleLevelChange()
 	}
 	
 	BuildNewLevel();
-	if (const UWorld* World = GetWorld())
-	{
-		World->GetTimerManager().SetTimerForNextTick(this, &ThisClass::RespawnLocalCharacter);
-	}
 }
 
 void ABoardGenerator::BuildNewLevel()
 {
 	// cleanup previous level
 	CleanupMazeContents();
-	const int Dim = CurrentMapLevelData.GetMazeDim();
-	check(Dim > 3);
-	Maze.Empty();
-	Maze.Init(FMapUnit(), Dim * Dim);
-	// these things need to stay in sync with the random stream so they are deterministic.
-	RandStream = FRandomStream(CurrentMapLevelData.Seed);
-	PlaceRandomRooms();
-	CarveSimpleMaze(0, 0);
-	GenerateMap();
+	SetActorTickEnabled(false);
+	PreloadReachableLevels();
+	const int BuildId = ++LevelBuildId;
+	const FMazeBuildParams Params = MakeBuildParams();
+	if (AAbyssTunnelsGameState* GameState = AAbyssTunnelsGameState::Get(this))
+	{
+		if (TSharedPtr<FMazeLayout, ESPMode::ThreadSafe> PreparedLayout = GameState->TakePreparedLayout(Params))
+		{
+			// built in the background while the previous level was played. just swap it in.
+			CommitLevelLayout(*PreparedLayout);
+			return;
+		}
+	}
+	if (!bGenerateLevelAsync)
+	{
+		FMazeLayout Layout;
+		FMazeLayoutBuilder::Build(Params, Layout);
+		CommitLevelLayout(Layout);
+		return;
+	}
+
+	// the layout is pure data so it gets built on the thread pool. only the commit comes back to the game thread.
+	TWeakObjectPtr<ABoardGenerator> WeakThis(this);
+	Async(EAsyncExecution::ThreadPool, [WeakThis, Params, BuildId]()
+	{
+		TSharedRef<FMazeLayout, ESPMode::ThreadSafe> Layout = MakeShared<FMazeLayout, ESPMode::ThreadSafe>();
+		FMazeLayoutBuilder::Build(Params, *Layout);
+		AsyncTask(ENamedThreads::GameThread, [WeakThis, Layout, BuildId]()
+		{
+			// the board may have been destroyed or started on another level while we were building.
+			ABoardGenerator* Board = WeakThis.Get();
+			if (Board && Board->LevelBuildId == BuildId)
+			{
+				Board->CommitLevelLayout(*Layout);
+			}
+		});
+	});
+}
+
+void ABoardGenerator::CommitLevelLayout(FMazeLayout& Layout)
+{
+	LastBuildStats = FLevelBuildStats();
+	LastBuildStats.Level = CurrentMapLevelData.Level;
+	LastBuildStats.Seed = CurrentMapLevelData.Seed;
+	LastBuildStats.MazeDim = Layout.Maze.GetDim();
+	LastBuildStats.RoomsMs = Layout.CoreTimings.RoomsMs;
+	LastBuildStats.CarveMs = Layout.CoreTimings.CarveMs;
+	LastBuildStats.TransformsMs = Layout.TransformsMs;
+	LastBuildStats.RoomsMemoryDelta = Layout.CoreTimings.RoomsMemoryDelta;
+	LastBuildStats.CarveMemoryDelta = Layout.CoreTimings.CarveMemoryDelta;
+	LastBuildStats.TransformsMemoryDelta = Layout.TransformsMemoryDelta;
+	Maze = MoveTemp(Layout.Maze);
+	RandStream = Layout.RandStream;
+	SpawnCells = MoveTemp(Layout.SpawnCells);
+	SpawnRandStream.Initialize(HashCombine(GetTypeHash(CurrentMapLevelData.Seed), GetTypeHash(CurrentMapLevelData.Level)));
+	if (HasAuthority())
+	{
+		if (USpawnClassPreloader* Preloader = USpawnClassPreloader::Get(this))
+		{
+			Preloader->WaitForLevel(this, CurrentMapLevelData.Level);
+		}
+	}
+	GenerateMap(Layout);
+	if (UCharacterIndexSubsystem* CharacterIndex = UCharacterIndexSubsystem::Get(this))
+	{
+		CharacterIndex->SetBoard(this);
+	}
+	if (bBuildVisibilitySet)
+	{
+		BuildVisibilitySet();
+	}
 	// only server spawns stuff.
 	if (HasAuthority())
 	{
-		ShuffleSpawnLocations();
+		const double ItemSpawnStartTime = FPlatformTime::Seconds();
+		const int64 ItemSpawnStartMemory = GetUsedPhysicalBytes();
+		ShuffleSpawnCells();
 		PopulateMazeWithObjects();
-		ShuffleSpawnLocations();
-		SetActorTickInterval(MonsterSpawnInterval);
-		SetActorTickEnabled(true);
+		ShuffleSpawnCells();
+		LastBuildStats.ItemSpawnMs = (FPlatformTime::Seconds() - ItemSpawnStartTime) * 1000.0;
+		LastBuildStats.ItemSpawnMemoryDelta = GetUsedPhysicalBytes() - ItemSpawnStartMemory;
+		if (const UWorld* World = GetWorld())
+		{
+			World->GetTimerManager().SetTimer(DistanceFieldTimerHandle, this, &ThisClass::UpdatePlayerDistanceFields, DistanceFieldUpdateInterval, true);
+			if (UMazeFlowFieldSubsystem* FlowFields = World->GetSubsystem<UMazeFlowFieldSubsystem>())
+			{
+				FlowFields->SetBoard(this);
+			}
+			if (UMonsterSpawnDirector* SpawnDirector = World->GetSubsystem<UMonsterSpawnDirector>())
+			{
+				SpawnDirector->SetBoard(this);
+			}
+		}
+		PredictNextLevel();
+	}
+	LastBuildStats.SpawnedActors = ActiveObjects.Num();
+	if (const UWorld* World = GetWorld())
+	{
+		World->GetTimerManager().SetTimerForNextTick(this, &ThisClass::RespawnLocalCharacter);
+	}
+}
+
+void ABoardGenerator::BuildVisibilitySet()
+{
+	TWeakObjectPtr<ABoardGenerator> WeakThis(this);
+	const int BuildId = LevelBuildId;
+	const int Level = CurrentMapLevelData.Level;
+	const int Radius = VisibilitySetRadius;
+	// the grid is copied so the board is free to move on to another level while this runs.
+	Async(EAsyncExecution::ThreadPool, [WeakThis, MazeCopy = Maze, BuildId, Level, Radius]()
+	{
+		const double StartTime = FPlatformTime::Seconds();
+		TSharedRef<FMazeVisibilitySet, ESPMode::ThreadSafe> NewSet = MakeShared<FMazeVisibilitySet, ESPMode::ThreadSafe>();
+		NewSet->Build(MazeCopy, Radius);
+		UE_LOG(LogTemp, Log, TEXT("Level %d (%dx%d): visibility set radius %d built in %.1f ms, %d words, %llu bytes"),
+			Level, MazeCopy.GetDim(), MazeCopy.GetDim(), NewSet->GetRadius(), (FPlatformTime::Seconds() - StartTime) * 1000.0,
+			NewSet->GetNumWords(), (uint64)NewSet->GetAllocatedSize());
+		AsyncTask(ENamedThreads::GameThread, [WeakThis, NewSet, BuildId]()
+		{
+			ABoardGenerator* Board = WeakThis.Get();
+			if (Board && Board->LevelBuildId == BuildId)
+			{
+				Board->VisibilitySet = NewSet;
+			}
+		});
+	});
+}
+
+void ABoardGenerator::PredictNextLevel()
+{
+	if (!bPrebuildNextLevel)
+	{
+		return;
+	}
+	if (AAbyssTunnelsGameState* GameState = AAbyssTunnelsGameState::Get(this))
+	{
+		const int NextLevel = CurrentMapLevelData.Level + (GameState->bIsAscending ? -1 : 1);
+		FRandomStream SeedStream;
+		SeedStream.GenerateNewSeed();
+		FlushNetDormancy();
+		NextMapLevelData.SetData(NextLevel, SeedStream.GetCurrentSeed(), GameState->bIsAscending); // clients pick this up in OnRep_NextMapLevelData
+		PreloadReachableLevels();
+		PrebuildNextLevel();
 	}
 }
 
+void ABoardGenerator::PreloadReachableLevels()
+{
+	if (USpawnClassPreloader* Preloader = USpawnClassPreloader::Get(this))
+	{
+		TArray<int> Levels = { CurrentMapLevelData.Level };
+		// NextMapLevelData still points at this level until the next one is predicted.
+		if (NextMapLevelData.Level >= 1)
+		{
+			Levels.AddUnique(NextMapLevelData.Level);
+		}
+		Preloader->SetReachableLevels(this, Levels);
+	}
+}
+
+void ABoardGenerator::PrebuildNextLevel()
+{
+	// ascending out of level 1 is the win sequence, nothing to build.
+	if (NextMapLevelData.Level < 1)
+	{
+		return;
+	}
+	AAbyssTunnelsGameState* GameState = AAbyssTunnelsGameState::Get(this);
+	if (!GameState)
+	{
+		return;
+	}
+	FMazeBuildParams Params = MakeBuildParams();
+	Params.LevelData = NextMapLevelData;
+	// this board is gone by the time the next level starts, so the result goes to the game state.
+	TWeakObjectPtr<AAbyssTunnelsGameState> WeakGameState(GameState);
+	Async(EAsyncExecution::ThreadPool, [WeakGameState, Params]()
+	{
+		TSharedRef<FMazeLayout, ESPMode::ThreadSafe> Layout = MakeShared<FMazeLayout, ESPMode::ThreadSafe>();
+		FMazeLayoutBuilder::Build(Params, *Layout);
+		AsyncTask(ENamedThreads::GameThread, [WeakGameState, Params, Layout]()
+		{
+			if (AAbyssTunnelsGameState* LiveGameState = WeakGameState.Get())
+			{
+				LiveGameState->StorePreparedLayout(Params, Layout);
+			}
+		});
+	});
+}
+
+FMazeBuildParams ABoardGenerator::MakeBuildParams() const
+{
+	FMazeBuildParams Params;
+	Params.LevelData = CurrentMapLevelData;
+	Params.TerrainUnitSize = TerrainUnitSize;
+	Params.OuterWallScaleFactor = OuterWallScaleFactor;
+	Params.OuterWallMin = OuterWallMin;
+	Params.NumWallVariants = MazeWallVariants.Num();
+	Params.bMergeInnerWalls = bMergeInnerWalls;
+	Params.WallChunkSize = WallChunkSize;
+	return Params;
+}
+
 void ABoardGenerator::RespawnLocalCharacter()
 {
 	if (const UWorld* World = GetWorld())
@@ -139,63 +400,106 @@ void ABoardGenerator::RespawnLocalCharacter()
 	}
 }
 
-void ABoardGenerator::InitializeMap(const int Level, const bool bParamIsAscending)
+void ABoardGenerator::InitializeMap(const int Level, const bool bParamIsAscending, const FMapLevelData& PredictedLevelData)
 {
 	if (HasAuthority())
 	{
-		RandStream.GenerateNewSeed();
-		int32 Seed = RandStream.GetCurrentSeed();
+		int32 Seed;
+		if (PredictedLevelData.Level == Level && PredictedLevelData.bIsAscending == bParamIsAscending)
+		{
+			// everyone already knows this seed from the previous board and has likely built the layout.
+			Seed = PredictedLevelData.Seed;
+		}
+		else
+		{
+			RandStream.GenerateNewSeed();
+			Seed = RandStream.GetCurrentSeed();
+		}
 		FlushNetDormancy();
 		CurrentMapLevelData.SetData(Level, Seed, bParamIsAscending); // this passes seed to all clients so they can build the maze.
 		HandleLevelChange();
 	}
 }
 
-void ABoardGenerator::GenerateMap()
+void ABoardGenerator::GenerateMap(const FMazeLayout& Layout)
 {
-	int MazeDim = CurrentMapLevelData.GetMazeDim();
-	// enclose the maze with some outer walls.
-	PlaceWall(FVector(OuterWallMin, OuterWallMin, 0), FVector(MazeDim, OuterWallMin, 0));
-	PlaceWall(FVector(OuterWallMin, MazeDim, 0), FVector(MazeDim, MazeDim, 0));
-	PlaceWall(FVector(OuterWallMin, OuterWallMin, 0), FVector(OuterWallMin, MazeDim, 0));
-	PlaceWall(FVector(MazeDim, OuterWallMin, 0), FVector(MazeDim, MazeDim, 0));
-	const float TerrainUnitSizeMultiplier = CurrentMapLevelData.GetTerrainUnitSizeMultiplier();
+	FInstanceCommitStats CommitStats;
+	CommitInstances(OuterMazeWalls, Layout.OuterWallTransforms, CommitStats);
 	if (MazeWallVariants.Num() > 0)
 	{
-		// generate walls according to the maze map
-		for (int i = 0; i < MazeDim; ++i)
+		// generate walls according to the maze map. one bulk commit per component instead of one call per wall.
+		const double CommitStartTime = FPlatformTime::Seconds();
+		const int64 CommitStartMemory = GetUsedPhysicalBytes();
+		int WallInstances = 0;
+		int WallComponents = 0;
+		TSet<UInstancedStaticMeshComponent*> CommittedComponents;
+		for (int Bucket = 0; Bucket < Layout.WallTransforms.Num(); ++Bucket)
+		{
+			const TArray<FTransform>& Transforms = Layout.WallTransforms[Bucket];
+			if (Transforms.Num() == 0)
+			{
+				continue;
+			}
+			UInstancedStaticMeshComponent* WallComponent = GetWallComponent(Bucket, Layout.NumWallChunks);
+			if (!WallComponent)
+			{
+				continue;
+			}
+			CommitInstances(WallComponent, Transforms, CommitStats);
+			CommittedComponents.Add(WallComponent);
+			WallInstances += Transforms.Num();
+			WallComponents++;
+		}
+		if (bRecycleInstances)
+		{
+			// anything this level didn't use still holds the previous level's walls.
+			auto ClearUnused = [&CommittedComponents, &CommitStats](UInstancedStaticMeshComponent* WallComponent)
+			{
+				if (WallComponent && !CommittedComponents.Contains(WallComponent) && WallComponent->GetInstanceCount() > 0)
+				{
+					CommitStats.Removed += WallComponent->GetInstanceCount();
+					WallComponent->ClearInstances();
+				}
+			};
+			for (UInstancedStaticMeshComponent* WallComponent : MazeWallVariants)
+			{
+				ClearUnused(WallComponent);
+			}
+			for (UHierarchicalInstancedStaticMeshComponent* WallComponent : WallChunkComponents)
+			{
+				ClearUnused(WallComponent);
+			}
+		}
+		LastBuildStats.InstancingMs = (FPlatformTime::Seconds() - CommitStartTime) * 1000.0;
+		LastBuildStats.InstancingMemoryDelta = GetUsedPhysicalBytes() - CommitStartMemory;
+		LastBuildStats.WallInstances = WallInstances;
+		LastBuildStats.WallComponents = WallComponents;
+		UE_LOG(LogTemp, Log, TEXT("Level %d: committed %d wall instances into %d components (%d chunks) in %.2f ms. %d updated, %d added, %d removed"),
+			CurrentMapLevelData.Level, WallInstances, WallComponents, Layout.NumWallChunks, LastBuildStats.InstancingMs,
+			CommitStats.Updated, CommitStats.Added, CommitStats.Removed);
+		if (HasAuthority())
 		{
-			for (int j = 0; j < MazeDim; ++j)
+			const double DoorSpawnStartTime = FPlatformTime::Seconds();
+			const int64 DoorSpawnStartMemory = GetUsedPhysicalBytes();
+			const FVector TargetScale = FVector(DoorScale, DoorScale, DoorScale);
+			// already resident, these only resolve the soft pointers.
+			const TSubclassOf<AActor> LoadedDoorClass = DoorClass.LoadSynchronous();
+			const TSubclassOf<AActor> LoadedDoorFrameClass = DoorFrameClass.LoadSynchronous();
+			for (const FTransform& Transform : Layout.DoorTransforms)
 			{
-				int Index = GetIndex(j,i);
-				if (Maze[Index].bIsWall)
+				if (AActor* Door = SpawnPooledActor(LoadedDoorClass, Transform))
 				{
-					int WallIndex = RandStream.RandRange(0, MazeWallVariants.Num() - 1);
-					const FVector Location = GetBaseOffset() + FVector(j * TerrainUnitSizeMultiplier * TerrainUnitSize, i * TerrainUnitSizeMultiplier * TerrainUnitSize, 0);
-					FTransform Transform = FTransform(Location);
-					const FVector TargetScale = FVector(TerrainUnitSizeMultiplier, TerrainUnitSizeMultiplier, OuterWallScaleFactor);
-					Transform.SetScale3D(TargetScale);
-					MazeWallVariants[WallIndex]->AddInstance(Transform);
-					UE_LOG(LogTemp, Warning, TEXT("%d now has %d instances"), WallIndex, MazeWallVariants[WallIndex]->GetInstanceCount());
+					Door->SetActorScale3D(TargetScale);
+					ActiveObjects.Add(Door);
 				}
-				if (HasAuthority() && Maze[Index].bIsDoor)
+				if (AActor* DoorFrame = SpawnPooledActor(LoadedDoorFrameClass, Transform))
 				{
-					const FVector Location = GetBaseOffset() + FVector(j * TerrainUnitSizeMultiplier * TerrainUnitSize, i * TerrainUnitSizeMultiplier * TerrainUnitSize, 0);
-					FTransform Transform = FTransform(Location);
-					Transform.SetRotation(FRotator(0,Maze[Index].DoorRotation, 0).Quaternion());
-					const FVector TargetScale = FVector(DoorScale, DoorScale, DoorScale);
-					if (AActor* Door = GetWorld()->SpawnActor<AActor>(DoorClass, Transform))
-					{
-						Door->SetActorScale3D(TargetScale);
-						ActiveObjects.Add(Door);
-					}
-					if (AActor* DoorFrame = GetWorld()->SpawnActor<AActor>(DoorFrameClass, Transform))
-					{
-						DoorFrame->SetActorScale3D(TargetScale);
-						ActiveObjects.Add(DoorFrame);
-					}
+					DoorFrame->SetActorScale3D(TargetScale);
+					ActiveObjects.Add(DoorFrame);
 				}
 			}
+			LastBuildStats.DoorSpawnMs = (FPlatformTime::Seconds() - DoorSpawnStartTime) * 1000.0;
+			LastBuildStats.DoorSpawnMemoryDelta = GetUsedPhysicalBytes() - DoorSpawnStartMemory;
 		}
 	}
 	else
@@ -204,177 +508,91 @@ void ABoardGenerator::GenerateMap()
 	}
 }
 
-// just for the outer walls to make it so they are contiguous instead of being made if units.
-void ABoardGenerator::PlaceWall(const FVector& StartPos, const FVector& EndPos)
+void ABoardGenerator::CommitInstances(UInstancedStaticMeshComponent* Component, const TArray<FTransform>& Transforms, FInstanceCommitStats& Stats)
 {
-	const float HorizLength = FMath::Abs(StartPos.X - EndPos.X);
-	const float VertLength = FMath::Abs(StartPos.Y - EndPos.Y);
-	const bool bHorizWall = HorizLength > VertLength;
-	const float TerrainUnitSizeMultiplier = CurrentMapLevelData.GetTerrainUnitSizeMultiplier();
-	const float WallLength = bHorizWall ? HorizLength : VertLength;
-	const FVector WallDirection = (EndPos - StartPos).GetSafeNormal();
-	const FVector WallCenter = StartPos + (WallDirection * WallLength * 0.5f);
-	FVector TargetScale;
-	if (bHorizWall)
-	{
-		TargetScale = FVector(FMath::Max((HorizLength + 1) * TerrainUnitSizeMultiplier, TerrainUnitSizeMultiplier), TerrainUnitSizeMultiplier, OuterWallScaleFactor);
-	}
-	else
+	if (!bRecycleInstances)
 	{
-		TargetScale = FVector(TerrainUnitSizeMultiplier, FMath::Max((VertLength + 1) * TerrainUnitSizeMultiplier, TerrainUnitSizeMultiplier), OuterWallScaleFactor);
-	}
-	const FVector Location = GetBaseOffset() + (WallCenter * TerrainUnitSizeMultiplier * TerrainUnitSize) + (bHorizWall?FVector(1,1,0):FVector::ZeroVector) + FVector(0,0,(TerrainUnitSize * OuterWallScaleFactor * 0.5f));
-	FTransform Transform = FTransform(Location);
-	Transform.SetScale3D(TargetScale);
-	OuterMazeWalls->AddInstance(Transform);
-}
-
-void ABoardGenerator::PlaceRandomRooms()
-{
-	const int MazeDim = CurrentMapLevelData.GetMazeDim();
-	int MinX = 2;
-	int MaxX = ModAdjust(MazeDim * 0.25f);
-	int MinY = 2;
-	int MaxY = ModAdjust(MazeDim * 0.25f);
-	int LargestYAttained = 0;
-	for (int i = 0; i < CurrentMapLevelData.MaxRooms; i++)
-	{
-		const int RoomDimIndexX = RandStream.RandRange(0, CurrentMapLevelData.RoomDims.Num() -1);
-		const int RoomDimIndexY = RandStream.RandRange(0, CurrentMapLevelData.RoomDims.Num() -1);
-		const int RoomDimX = CurrentMapLevelData.RoomDims[RoomDimIndexX];
-		const int RoomDimY = CurrentMapLevelData.RoomDims[RoomDimIndexY];
-		FVector2d TopLeftCorner = FVector2d(ModAdjust(RandStream.RandRange(MinX, MaxX)), ModAdjust(RandStream.RandRange(MinY, MaxY)));
-		FVector2d BottomRightCorner = FVector2d(TopLeftCorner.X + RoomDimX, TopLeftCorner.Y + RoomDimY);
-		if (BottomRightCorner.Y > LargestYAttained)
-		{
-			LargestYAttained = BottomRightCorner.Y;
-		}
-		MinX = BottomRightCorner.X + 2;
-		MaxX = MinX + CurrentMapLevelData.RoomDims[CurrentMapLevelData.RoomDims.Num()-1];
-		if (TopLeftCorner.X + RoomDimX > MazeDim - 1)
-		{
-			// time to wrap x around to next y part of map
-			MinY = LargestYAttained + 2;
-			MaxY = ModAdjust(MinY + CurrentMapLevelData.RoomDims[CurrentMapLevelData.RoomDims.Num()-1]);
-			// reset x
-			MinX = 2;
-			MaxX = ModAdjust(MazeDim * 0.25f);
-		}
-		
-		BottomRightCorner.X = FMath::Min(BottomRightCorner.X, MazeDim -1);
-		BottomRightCorner.Y = FMath::Min(BottomRightCorner.Y, MazeDim -1);
-		if (BottomRightCorner.X - TopLeftCorner.X < CurrentMapLevelData.RoomDims[0] || BottomRightCorner.Y - TopLeftCorner.Y < CurrentMapLevelData.RoomDims[0])
-		{
-			// room too smol to be valid. discard.
-			continue;
-		}
-		
-		for (int j = TopLeftCorner.X; j <= BottomRightCorner.X; j++)
+		if (CVarWallCommitPerInstance.GetValueOnGameThread())
 		{
-			for (int k = TopLeftCorner.Y; k <= BottomRightCorner.Y; k++)
+			for (const FTransform& Transform : Transforms)
 			{
-				int Index = GetIndex(j, k);
-				Maze[Index].bIsWall = false;
-				Maze[Index].bIsRoom = true;
-				Maze[Index].bIsSpawn = false;
+				Component->AddInstance(Transform);
 			}
 		}
-		
-		const int RoomCenterX = TopLeftCorner.X + (BottomRightCorner.X - TopLeftCorner.X) / 2;
-		const int RoomCenterY = TopLeftCorner.Y + (BottomRightCorner.Y - TopLeftCorner.Y) / 2;
-		Maze[GetIndex(RoomCenterX, RoomCenterY)].bIsSpawn = true;
-		// put a door in each wall.
-		if (BottomRightCorner.Y < MazeDim - 1)
+		else
 		{
-			if (Maze[GetIndex(RoomCenterX - 1, BottomRightCorner.Y + 1)].bIsWall &&
-				Maze[GetIndex(RoomCenterX + 1, BottomRightCorner.Y + 1)].bIsWall)
-			{
-				int Index = GetIndex(RoomCenterX, BottomRightCorner.Y + 1);
-				Maze[Index].bIsDoor = true;
-				Maze[Index].bIsWall = false;
-				Maze[Index].DoorRotation = 90.0f;
-			}
+			Component->AddInstances(Transforms, false);
 		}
-		if (BottomRightCorner.X < MazeDim - 1)
+		Stats.Added += Transforms.Num();
+		return;
+	}
+
+	// keep whatever instances the component already has, move as many as we can and only add/remove the difference.
+	const int Existing = Component->GetInstanceCount();
+	const int Overlap = FMath::Min(Existing, Transforms.Num());
+	if (Overlap > 0)
+	{
+		if (Overlap == Transforms.Num())
 		{
-			if (Maze[GetIndex(BottomRightCorner.X + 1, RoomCenterY - 1)].bIsWall &&
-				Maze[GetIndex(BottomRightCorner.X + 1, RoomCenterY + 1)].bIsWall)
-			{
-				Maze[GetIndex(BottomRightCorner.X + 1, RoomCenterY)].bIsDoor = true;
-				Maze[GetIndex(BottomRightCorner.X + 1, RoomCenterY)].bIsWall = false;
-			}
+			Component->BatchUpdateInstancesTransforms(0, Transforms, false, false, true);
 		}
-		if (Maze[GetIndex(RoomCenterX - 1, TopLeftCorner.Y - 1)].bIsWall &&
-			Maze[GetIndex(RoomCenterX + 1, TopLeftCorner.Y - 1)].bIsWall)
+		else
 		{
-			int Index = GetIndex(RoomCenterX, TopLeftCorner.Y - 1);
-			Maze[Index].bIsDoor = true;
-			Maze[Index].bIsWall = false;
-			Maze[Index].DoorRotation = 90.0f;
+			const TArray<FTransform> Updated(Transforms.GetData(), Overlap);
+			Component->BatchUpdateInstancesTransforms(0, Updated, false, false, true);
 		}
-		if (Maze[GetIndex(TopLeftCorner.X - 1, RoomCenterY - 1)].bIsWall &&
-			Maze[GetIndex(TopLeftCorner.X - 1, RoomCenterY + 1)].bIsWall)
+		Stats.Updated += Overlap;
+	}
+	if (Transforms.Num() > Existing)
+	{
+		const TArray<FTransform> Added(Transforms.GetData() + Existing, Transforms.Num() - Existing);
+		Component->AddInstances(Added, false);
+		Stats.Added += Added.Num();
+	}
+	else if (Existing > Transforms.Num())
+	{
+		TArray<int32> Removed;
+		Removed.Reserve(Existing - Transforms.Num());
+		for (int i = Existing - 1; i >= Transforms.Num(); --i)
 		{
-			Maze[GetIndex(TopLeftCorner.X - 1, RoomCenterY)].bIsDoor = true;
-			Maze[GetIndex(TopLeftCorner.X - 1, RoomCenterY)].bIsWall = false;
+			Removed.Add(i);
 		}
+		Component->RemoveInstances(Removed);
+		Stats.Removed += Removed.Num();
 	}
+	Component->MarkRenderStateDirty();
 }
 
-void ABoardGenerator::CarveSimpleMaze(const int X, const int Y)
+UInstancedStaticMeshComponent* ABoardGenerator::GetWallComponent(const int Bucket, const int NumWallChunks)
 {
-	Maze[GetIndex(X,Y)].bIsWall = false;
-	int Direction = RandStream.RandRange(0,3);
-	bool WayFound = false;
-	for (int i = 0; i < 4; ++i)
+	const int NumVariants = MazeWallVariants.Num();
+	UInstancedStaticMeshComponent* Template = MazeWallVariants[Bucket % NumVariants];
+	if (WallChunkSize <= 0 || NumWallChunks <= 1)
 	{
-		switch (Direction)
-		{
-			case 0: // north
-				if (Y-2 >= 0 && Maze[GetIndex(X,Y-2)].bIsWall)
-				{
-					WayFound = true;
-					Maze[GetIndex(X, Y-1)].bIsWall = false;
-					CarveSimpleMaze(X,Y-2);
-				}
-				break;
-			case 1: // south
-				if (Y+2 < CurrentMapLevelData.GetMazeDim() && Maze[GetIndex(X,Y+2)].bIsWall)
-				{
-					WayFound = true;
-					Maze[GetIndex(X, Y+1)].bIsWall = false;
-					CarveSimpleMaze(X,Y+2);
-				}
-				break;
-			case 2: // east
-				if (X+2 < CurrentMapLevelData.GetMazeDim() && Maze[GetIndex(X+2,Y)].bIsWall)
-				{
-					WayFound = true;
-					Maze[GetIndex(X+1, Y)].bIsWall = false;
-					CarveSimpleMaze(X+2,Y);
-				}
-				break;
-			case 3: // west
-				if (X - 2 >= 0 && Maze[GetIndex(X - 2, Y)].bIsWall)
-				{
-					WayFound = true;
-					Maze[GetIndex(X-1, Y)].bIsWall = false;
-					CarveSimpleMaze(X-2,Y);
-				}
-				break;
-			default:
-				UE_LOG(LogTemp, Error, TEXT("math is hard"));
-		}
-		Direction++;
-		if (Direction > 3)
-		{
-			Direction = 0;
-		}
+		return Template;
 	}
-	if (!WayFound)
+	if (WallChunkComponents.Num() < NumWallChunks * NumVariants)
 	{
-		Maze[GetIndex(X, Y)].bIsSpawn = true;
+		WallChunkComponents.SetNum(NumWallChunks * NumVariants);
 	}
+	if (!WallChunkComponents[Bucket])
+	{
+		// chunk components are made on demand and copy what matters from the variant they stand in for.
+		UHierarchicalInstancedStaticMeshComponent* ChunkComponent = NewObject<UHierarchicalInstancedStaticMeshComponent>(this);
+		ChunkComponent->SetStaticMesh(Template->GetStaticMesh());
+		for (int i = 0; i < Template->GetNumMaterials(); ++i)
+		{
+			ChunkComponent->SetMaterial(i, Template->GetMaterial(i));
+		}
+		ChunkComponent->SetCollisionProfileName(Template->GetCollisionProfileName());
+		ChunkComponent->SetCollisionEnabled(Template->GetCollisionEnabled());
+		ChunkComponent->SetCastShadow(Template->CastShadow);
+		ChunkComponent->SetCullDistances(Template->InstanceStartCullDistance, Template->InstanceEndCullDistance);
+		ChunkComponent->SetupAttachment(Root);
+		ChunkComponent->RegisterComponent();
+		WallChunkComponents[Bucket] = ChunkComponent;
+	}
+	return WallChunkComponents[Bucket];
 }
 
 void ABoardGenerator::ClearMazeCenter()
@@ -382,74 +600,136 @@ void ABoardGenerator::ClearMazeCenter()
 	const int Dim = CurrentMapLevelData.GetMazeDim();
 	int CenterX = Dim / 2;
 	int CenterY = Dim / 2;
-	Maze[GetIndex(CenterX, CenterY)].bIsWall = false;
+	Maze.SetWall(GetIndex(CenterX, CenterY), false);
 }
 
 bool ABoardGenerator::IsNearPlayerCharacter(const FVector& Location) const
 {
-	if (UWorld* World = GetWorld())
+	if (PlayerDistanceFields.Num() > 0)
+	{
+		return IsCellNearPlayerCharacter(ConvertPositionToMazeIndex(Location));
+	}
+	// no fields yet (first frames of a level), fall back to straight line distance.
+	if (UCharacterIndexSubsystem* CharacterIndex = UCharacterIndexSubsystem::Get(this))
 	{
 		const float TerrainUnitSizeMultiplier = CurrentMapLevelData.GetTerrainUnitSizeMultiplier();
-		for (FConstPlayerControllerIterator Iterator = World->GetPlayerControllerIterator(); Iterator; ++Iterator)
-		{
-			APlayerController* PlayerController = Iterator->Get();
-			if (PlayerController == nullptr || PlayerController->Player == nullptr)
-			{
-				continue;
-			}
-
-			if (APawn* Pawn = PlayerController->GetPawn())
-			{
-				if (FMath::Abs(Location.X - Pawn->GetActorLocation().X) < (MinSpawnUnitsFromPlayerCharacter * TerrainUnitSize * TerrainUnitSizeMultiplier))
-				{
-					return true;
-				}
-			}
-		}
+		return CharacterIndex->AnyInRadius(Location, MinSpawnUnitsFromPlayerCharacter * TerrainUnitSize * TerrainUnitSizeMultiplier, ECharacterIndexFilter::Players);
 	}
 	return false;
 }
 
-AAbyssTunnelsCharacter* ABoardGenerator::SpawnAIFromClass(TSubclassOf<AAbyssTunnelsCharacter> PawnClass, UBehaviorTree* BehaviorTree, FVector Location, FRotator Rotation, bool bNoCollisionFail)
+bool ABoardGenerator::IsCellNearPlayerCharacter(const int Index) const
 {
-	AAbyssTunnelsCharacter* NewPawn = NULL;
+	return GetCellDistanceToNearestPlayer(Index) <= MinSpawnUnitsFromPlayerCharacter;
+}
 
-	UWorld* World = GEngine->GetWorldFromContextObject(this, EGetWorldErrorMode::LogAndReturnNull);
-	if (World && *PawnClass)
+int ABoardGenerator::GetCellDistanceToNearestPlayer(const int Index) const
+{
+	int32 Nearest = FMazeDistanceField::Unreachable;
+	for (const auto& Entry : PlayerDistanceFields)
 	{
-		FActorSpawnParameters ActorSpawnParams;
-		ActorSpawnParams.Owner = Owner;
-		ActorSpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AdjustIfPossibleButAlwaysSpawn;
+		Nearest = FMath::Min(Nearest, Entry.Value.GetDistance(Index));
+	}
+	return Nearest;
+}
 
-		NewPawn = World->SpawnActor<AAbyssTunnelsCharacter>(*PawnClass, Location, Rotation, ActorSpawnParams);
+int ABoardGenerator::GetWalkingDistanceToNearestPlayer(const FVector& Location) const
+{
+	const int32 Distance = GetCellDistanceToNearestPlayer(ConvertPositionToMazeIndex(Location));
+	return Distance == FMazeDistanceField::Unreachable ? -1 : Distance;
+}
 
-		if (NewPawn != NULL)
+int ABoardGenerator::GetWalkingDistanceToExit(const FVector& Location) const
+{
+	const int32 Distance = GetCellDistanceToExit(ConvertPositionToMazeIndex(Location));
+	return Distance == FMazeDistanceField::Unreachable ? -1 : Distance;
+}
+
+void ABoardGenerator::UpdatePlayerDistanceFields()
+{
+	UCharacterIndexSubsystem* CharacterIndex = UCharacterIndexSubsystem::Get(this);
+	if (!CharacterIndex || Maze.Num() == 0)
+	{
+		return;
+	}
+	const FCharacterSnapshot& Snapshot = CharacterIndex->GetSnapshot();
+	TSet<TWeakObjectPtr<APawn>> SeenPawns;
+	for (const int32 Entry : Snapshot.PlayerEntries)
+	{
+		APawn* Pawn = Snapshot.Characters[Entry];
+		SeenPawns.Add(Pawn);
+		const int Cell = ConvertPositionToMazeIndex(Snapshot.GetLocation(Entry));
+		// standing on the edge of a wall cell (or off the grid) keeps the last good field.
+		if (!Maze.IsValidIndex(Cell) || Maze.IsWall(Cell))
 		{
-			if (NewPawn->Controller == NULL)
-			{	// NOTE: SpawnDefaultController ALSO calls Possess() to possess the pawn (if a controller is successfully spawned).
-				NewPawn->SpawnDefaultController();
-			}
+			continue;
+		}
+		FMazeDistanceField& Field = PlayerDistanceFields.FindOrAdd(Pawn);
+		if (Field.GetSourceCell() != Cell)
+		{
+			Field.Build(Maze, Cell);
+		}
+	}
+	for (auto It = PlayerDistanceFields.CreateIterator(); It; ++It)
+	{
+		if (!SeenPawns.Contains(It.Key()))
+		{
+			It.RemoveCurrent();
+		}
+	}
+}
 
-			if (BehaviorTree != NULL)
-			{
-				if (AAIController* AIController = Cast<AAIController>(NewPawn->Controller))
-				{
-					AIController->RunBehaviorTree(BehaviorTree);
-				}
-			}
+EMazeSight ABoardGenerator::TraceGridLineOfSight(const FVector& From, const FVector& To) const
+{
+	if (Maze.Num() == 0)
+	{
+		return EMazeSight::Unknown;
+	}
+	// the set is cell center to cell center, close enough for characters standing in those cells.
+	if (VisibilitySet.IsValid())
+	{
+		const EMazeSight Sight = VisibilitySet->Query(ConvertPositionToMazeIndex(From), ConvertPositionToMazeIndex(To));
+		if (Sight != EMazeSight::Unknown)
+		{
+			return Sight;
 		}
 	}
+	const float CellSize = TerrainUnitSize * CurrentMapLevelData.GetTerrainUnitSizeMultiplier();
+	const FVector Base = GetBaseOffset();
+	const FVector2D Start((From.X - Base.X) / CellSize, (From.Y - Base.Y) / CellSize);
+	const FVector2D End((To.X - Base.X) / CellSize, (To.Y - Base.Y) / CellSize);
+	return FMazeLineOfSight::Trace(Maze, Start, End);
+}
 
-	return NewPawn;
+bool ABoardGenerator::HasLineOfSight(const FVector& From, const FVector& To) const
+{
+	if (CVarGridLineOfSight.GetValueOnGameThread())
+	{
+		const EMazeSight Sight = TraceGridLineOfSight(From, To);
+		if (Sight != EMazeSight::Unknown)
+		{
+			return Sight == EMazeSight::Clear;
+		}
+	}
+	FHitResult Hit;
+	return !GetWorld()->LineTraceSingleByChannel(Hit, From, To, ECC_GameTraceChannel1); // environment channel
 }
 
-int ABoardGenerator::ConvertPositionToMazeIndex(const FVector& Position)
+int ABoardGenerator::ConvertPositionToMazeIndex(const FVector& Position) const
 {
 	const float TerrainUnitSizeMultiplier = CurrentMapLevelData.GetTerrainUnitSizeMultiplier();
 	FVector AdjustedPos = Position - GetBaseOffset();
 	AdjustedPos.X /= (TerrainUnitSize * TerrainUnitSizeMultiplier);
 	AdjustedPos.Y /= (TerrainUnitSize * TerrainUnitSizeMultiplier);
-	return AdjustedPos.Y / CurrentMapLevelData.GetMazeDim() + AdjustedPos.X;
+	// ConvertUnitsToLocation puts cells at their centers so round to the closest one.
+	const int X = FMath::RoundToInt(AdjustedPos.X);
+	const int Y = FMath::RoundToInt(AdjustedPos.Y);
+	const int MazeDim = CurrentMapLevelData.GetMazeDim();
+	if (X < 0 || X >= MazeDim || Y < 0 || Y >= MazeDim)
+	{
+		return INDEX_NONE;
+	}
+	return GetIndex(X, Y);
 }
 
 FVector ABoardGenerator::ConvertUnitsToLocation(const FVector2d& MapGridUnitsLocation) const
@@ -463,107 +743,97 @@ FVector ABoardGenerator::ConvertUnitsToLocation(const FVector2d& MapGridUnitsLoc
 	return RetVector;
 }
 
-void ABoardGenerator::SpawnRandomMonster()
+bool ABoardGenerator::SpawnRandomMonster()
 {
-	float SpawnChance = 0.4f;
-	TSubclassOf<AAbyssTunnelsCharacter> ChosenMonster = nullptr;
-	// pick a monster to spawn.
-	for (const auto& Entry : SpawnableMonsters)
+	const UMonsterSpawnDirector* SpawnDirector = UMonsterSpawnDirector::Get(this);
+	const TSubclassOf<AAbyssTunnelsCharacter> ChosenMonster = SpawnDirector ? SpawnDirector->PickMonsterClass(SpawnRandStream) : nullptr;
+	if (!ChosenMonster)
 	{
-		if (Entry.Key >= CurrentMapLevelData.Level)
-		{
-			if (!ChosenMonster)
-			{
-				ChosenMonster = Entry.Value;
-			}
-			else if (FMath::FRand() < SpawnChance)
-			{
-				ChosenMonster = Entry.Value;
-			}
-		}
+		return false;
 	}
 
+	// skip spawn cells a player could walk to within MinSpawnUnitsFromPlayerCharacter.
+	UpdatePlayerDistanceFields();
+	while (SpawnTopIndex >= 0 && IsCellNearPlayerCharacter(SpawnCells[SpawnTopIndex]))
+	{
+		SpawnTopIndex--;
+	}
 	if (SpawnTopIndex >= 0)
 	{
-		FVector SpawnLoc = ConvertUnitsToLocation(ShuffledSpawnLocations[SpawnTopIndex]);
+		FVector SpawnLoc = ConvertUnitsToLocation(ConvertIndexToCoords(SpawnCells[SpawnTopIndex]));
 		SpawnTopIndex--;
 		if (TObjectPtr<AAbyssTunnelsCharacter> NewMonster = SpawnAIFromClass(ChosenMonster, nullptr, SpawnLoc, FRotator::ZeroRotator))
 		{
+			NewMonster->OnDestroyed.AddDynamic(this, &ThisClass::OnMonsterDestroyed);
 			ActiveMonsters.Add(NewMonster);
+			return true;
 		}
+		return false;
 	}
-	else
-	{
-		ShuffleSpawnLocations();
-	}
+	ShuffleSpawnCells();
+	return false;
+}
+
+void ABoardGenerator::OnMonsterDestroyed(AActor* DestroyedActor)
+{
+	ActiveMonsters.RemoveSwap(Cast<AAbyssTunnelsCharacter>(DestroyedActor));
 }
 
 void ABoardGenerator::PopulateMazeWithObjects()
 {
-	if (ShuffledSpawnLocations.Num() == 0)
+	if (SpawnCells.Num() == 0)
 	{
 		UE_LOG(LogTemp, Error, TEXT("No spawn locations found!"));
 		return;
 	}
-	TArray<FSpawnTableEntry> RoomSpawnTable;
-	TArray<FSpawnTableEntry> DeadEndSpawnTable;
-	for (const auto Entry : SpawnDataAsset->SpawnTable)
-	{
-		if (Entry.bCanSpawnInDeadEnds)
-		{
-			DeadEndSpawnTable.Add(Entry);
-		}
-		RoomSpawnTable.Add(Entry);
-	}
 	if (UWorld* World = GetWorld())
 	{
-		FVector2d SpawnLoc = ShuffledSpawnLocations[SpawnTopIndex];
+		const int SpawnCell = SpawnCells[SpawnTopIndex];
 		SpawnTopIndex--;
-		if (ExitActorClass)
+		if (!ExitActorClass.IsNull())
 		{
-			FTransform Transform = FTransform(ConvertUnitsToLocation(SpawnLoc));
-			ActiveObjects.Add(World->SpawnActor<AActor>(ExitActorClass, Transform));
+			FTransform Transform = FTransform(ConvertUnitsToLocation(ConvertIndexToCoords(SpawnCell)));
+			ActiveObjects.Add(SpawnPooledActor(ExitActorClass.LoadSynchronous(), Transform));
+			ExitCell = SpawnCell;
+			ExitDistanceField.Build(Maze, ExitCell);
 		}
-
-		const int ItemsToSpawn = CurrentMapLevelData.NumberOfItems();
-		int SpawnTableIndex = 0;
-		while (SpawnTopIndex >= 0 && SpawnTableIndex < SpawnDataAsset->SpawnTable.Num())
+		if (!SpawnDataAsset)
 		{
-			FSpawnTableEntry Entry = SpawnDataAsset->SpawnTable[SpawnTableIndex];
-			if (Entry.MinimumLevel <= CurrentMapLevelData.Level && Entry.MaximumLevel >= CurrentMapLevelData.Level && Entry.SpawnableObjectClass
-				&& FMath::FRand() < Entry.SpawnChance)
-			{
-				SpawnLoc = ShuffledSpawnLocations[SpawnTopIndex];
-				FTransform Transform = FTransform(ConvertUnitsToLocation(SpawnLoc));
-				FRotator Rotation = FRotator(0, FMath::RandRange(0, 360), 0);
-				Transform.SetRotation(Rotation.Quaternion());
-				AActor* SpawnedItem = World->SpawnActor<AActor>(Entry.SpawnableObjectClass, Transform);
-				ActiveObjects.Add(SpawnedItem);
-			}
-			else
-			{
-				SpawnTableIndex++;
-				continue;
-			}
+			return;
+		}
 
-			// we still have spaces for more items... so let's try again to place some.
-			SpawnTableIndex++;
-			if (SpawnTableIndex == SpawnDataAsset->SpawnTable.Num() && ActiveObjects.Num() < ItemsToSpawn)
-			{
-				SpawnTableIndex = 0;
-			}
-			
-			SpawnTopIndex--;
+		// the whole plan is made up front, then spawned.
+		FItemSpawnPlanner Planner;
+		Planner.Compile(SpawnDataAsset->SpawnTable, CurrentMapLevelData.Level);
+		TArray<FItemPlacement> Plan;
+		Planner.Plan(Maze, MakeArrayView(SpawnCells.GetData(), SpawnTopIndex + 1), CurrentMapLevelData.NumberOfItems(), SpawnRandStream, Plan);
+		for (const FItemPlacement& Placement : Plan)
+		{
+			FTransform Transform = FTransform(ConvertUnitsToLocation(ConvertIndexToCoords(Placement.Cell)));
+			Transform.SetRotation(FRotator(0, Placement.Yaw, 0).Quaternion());
+			AActor* SpawnedItem = SpawnPooledActor(SpawnDataAsset->SpawnTable[Placement.EntryIndex].SpawnableObjectClass.LoadSynchronous(), Transform);
+			ActiveObjects.Add(SpawnedItem);
 		}
 	}
 }
 
 void ABoardGenerator::CleanupMazeContents()
 {
-	OuterMazeWalls->ClearInstances();
-	for (const auto Entry : MazeWallVariants)
+	// when recycling, the next GenerateMap reuses the existing instances instead.
+	if (!bRecycleInstances)
 	{
-		Entry->ClearInstances();
+		OuterMazeWalls->ClearInstances();
+		for (const auto Entry : MazeWallVariants)
+		{
+			Entry->ClearInstances();
+		}
+		for (const auto Entry : WallChunkComponents)
+		{
+			if (Entry)
+			{
+				Entry->ClearInstances();
+			}
+		}
 	}
 	if (HasAuthority())
 	{
@@ -578,14 +848,34 @@ void ABoardGenerator::CleanupMazeContents()
 		{
 			if (AActor* Obj = ActiveObjects.Pop())
 			{
-				Obj->Destroy();
+				ReleasePooledActor(Obj);
 			}
 		}
 	}
-	if (AAbyssTunnelsPlayerController* PlayerController = Cast<AAbyssTunnelsPlayerController>(GetWorld()->GetFirstPlayerController()))
+	if (UDecalManagerComponent* DecalManager = UDecalManagerComponent::Get(this))
 	{
-		PlayerController->ClearAllDecals();
+		DecalManager->ClearDecals();
 	}
 	ActiveMonsters.Empty();
 	ActiveObjects.Empty();
+	if (const UWorld* World = GetWorld())
+	{
+		World->GetTimerManager().ClearTimer(DistanceFieldTimerHandle);
+		if (UMazeFlowFieldSubsystem* FlowFields = World->GetSubsystem<UMazeFlowFieldSubsystem>())
+		{
+			FlowFields->ClearBoard(this);
+		}
+		if (UMonsterSpawnDirector* SpawnDirector = World->GetSubsystem<UMonsterSpawnDirector>())
+		{
+			SpawnDirector->ClearBoard(this);
+		}
+		if (UCharacterIndexSubsystem* CharacterIndex = World->GetSubsystem<UCharacterIndexSubsystem>())
+		{
+			CharacterIndex->ClearBoard(this);
+		}
+	}
+	ExitCell = INDEX_NONE;
+	ExitDistanceField.Reset();
+	VisibilitySet.Reset();
+	PlayerDistanceFields.Empty();
 }
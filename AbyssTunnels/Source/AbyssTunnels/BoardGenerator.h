@@ -5,6 +5,10 @@
 #include "CoreMinimal.h"
 #include "GameFramework/Actor.h"
 #include "MapLevelData.h"
+#include "MazeLayoutBuilder.h"
+#include "MazeDistanceField.h"
+#include "MazeLineOfSight.h"
+#include "MazeVisibilitySet.h"
 #include "BoardGenerator.generated.h"
 
 class USpawnDataAsset;
@@ -12,14 +16,41 @@ class AInstancedMeshActor;
 class AAbyssTunnelsCharacter;
 class UBehaviorTree;
 class ASpawnableObject;
+class UHierarchicalInstancedStaticMeshComponent;
+class UActorPoolComponent;
 
-struct FMapUnit
+// what the last BuildNewLevel cost, phase by phase. filled in as the level gets committed.
+struct FLevelBuildStats
 {
-	bool bIsWall = true;
-	bool bIsRoom = false;
-	bool bIsSpawn = false;
-	bool bIsDoor = false;
-	float DoorRotation = 0.0f;
+	int Level = 0;
+	int32 Seed = 0;
+	int MazeDim = 0;
+	// layout phases, these ran on a worker thread when building async.
+	double RoomsMs = 0.0;
+	double CarveMs = 0.0;
+	double TransformsMs = 0.0;
+	// game thread commit phases.
+	double InstancingMs = 0.0;
+	double DoorSpawnMs = 0.0;
+	double ItemSpawnMs = 0.0;
+	int WallInstances = 0;
+	int WallComponents = 0;
+	int SpawnedActors = 0;
+	// change in the process's used physical memory over each phase, in bytes. negative when something got freed.
+	// the layout ones take whatever else the process allocated meanwhile too when the layout was built async.
+	int64 RoomsMemoryDelta = 0;
+	int64 CarveMemoryDelta = 0;
+	int64 TransformsMemoryDelta = 0;
+	int64 InstancingMemoryDelta = 0;
+	int64 DoorSpawnMemoryDelta = 0;
+	int64 ItemSpawnMemoryDelta = 0;
+};
+
+struct FInstanceCommitStats
+{
+	int Updated = 0;
+	int Added = 0;
+	int Removed = 0;
 };
 
 UCLASS()
@@ -30,10 +61,10 @@ public:
 	ABoardGenerator();
 	void HandleLevelChange();
 	void BuildNewLevel();
-	void PlaceWall(const FVector& StartPos, const FVector& EndPos);
-	int ConvertPositionToMazeIndex(const FVector& Position);
+	// INDEX_NONE when the position is off the grid.
+	int ConvertPositionToMazeIndex(const FVector& Position) const;
 	FVector ConvertUnitsToLocation(const FVector2d& MapGridUnitsLocation) const;
-	virtual void Tick(float DeltaSeconds) override;
+	const FLevelBuildStats& GetLastBuildStats() const { return LastBuildStats; }
 	virtual void EndPlay(const EEndPlayReason::Type Reason) override;
 
 	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Abyss")
@@ -62,9 +93,17 @@ public:
 	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Abyss")
 	int OuterWallMin = -1;
 
+	// the level we expect players to go to next, with its seed already picked. replicated early so
+	// server and clients can build that layout in the background while this level is played.
+	UPROPERTY(ReplicatedUsing=OnRep_NextMapLevelData)
+	FMapLevelData NextMapLevelData;
+
 	UFUNCTION()
 	void RespawnLocalCharacter();
 
+	UFUNCTION()
+	void OnRep_NextMapLevelData();
+
 	UFUNCTION()
 	void OnRep_CurrentMapLevelData(FMapLevelData& OldMapLevelData);
 
@@ -75,22 +114,56 @@ public:
 	float OuterWallScaleFactor = 20.f;
 
 	UPROPERTY(EditAnywhere, Category = "Abyss")
-	TSubclassOf<AActor> ExitActorClass;
+	TSoftClassPtr<AActor> ExitActorClass;
 
-	// prevent monsters from spawning too close to player
+	// prevent monsters from spawning too close to player. walking distance in maze cells.
 	UPROPERTY(EditAnywhere, Category = "Abyss")
 	int MinSpawnUnitsFromPlayerCharacter = 3;
 
-	// monsters indexed by their minimum level in which they can spawn.
+	// how often (seconds) the server checks whether players moved to a new cell. only players that did get their
+	// distance field rebuilt.
+	UPROPERTY(EditAnywhere, Category = "Abyss", meta = (ClampMin = "0.01"))
+	float DistanceFieldUpdateInterval = 0.2f;
+
+	// walking distance in cells from Location to the closest player, -1 if no player can reach it. server only.
+	UFUNCTION(BlueprintPure, Category = "Abyss")
+	int GetWalkingDistanceToNearestPlayer(const FVector& Location) const;
+
+	// walking distance in cells from Location to the exit, -1 if there is no exit or it can't be reached. server only.
+	UFUNCTION(BlueprintPure, Category = "Abyss")
+	int GetWalkingDistanceToExit(const FVector& Location) const;
+
+	// can From see To. answered from the wall cells when possible, only falls back to an environment channel trace
+	// when the segment leaves the grid or crosses a door (doors are actors, not grid walls).
+	UFUNCTION(BlueprintPure, Category = "Abyss")
+	bool HasLineOfSight(const FVector& From, const FVector& To) const;
+
+	// just the grid part, in world space. Unknown when physics has to decide.
+	EMazeSight TraceGridLineOfSight(const FVector& From, const FVector& To) const;
+
+	// cell level versions of the above for code that already works in maze indices.
+	int GetCellDistanceToNearestPlayer(const int Index) const;
+	int GetCellDistanceToExit(const int Index) const { return ExitDistanceField.GetDistance(Index); }
+	const FMazeDistanceField& GetExitDistanceField() const { return ExitDistanceField; }
+	const FMazeGrid& GetMaze() const { return Maze; }
+
+	// monsters indexed by their minimum level in which they can spawn. soft, USpawnClassPreloader loads them by level.
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Abyss")
-	TMap<int, TSubclassOf<AAbyssTunnelsCharacter>> SpawnableMonsters;
+	TMap<int, TSoftClassPtr<AAbyssTunnelsCharacter>> SpawnableMonsters;
 
+	// the class comes from UMonsterSpawnDirector's table for this level. false when nothing was spawned.
 	UFUNCTION(BlueprintCallable, Category = "Abyss")
-	void SpawnRandomMonster();
+	bool SpawnRandomMonster();
 
+	// the live population, monsters take themselves out of here when they are destroyed.
 	UPROPERTY(VisibleAnywhere, Transient, Category = "Abyss")
 	TArray<TObjectPtr<AAbyssTunnelsCharacter>> ActiveMonsters;
 
+	// how much of the monster cap the spawn director fills right after a level transition (under its frame budget).
+	// the rest trickles in one every MonsterSpawnInterval. 0 is the old behaviour of starting the level empty.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Abyss", meta = (ClampMin = "0", ClampMax = "1"))
+	float InitialMonsterFraction = 1.f;
+
 	UPROPERTY(VisibleAnywhere, Transient, Category = "Abyss")
 	TArray<TObjectPtr<AActor>> ActiveObjects;
 
@@ -100,71 +173,128 @@ public:
 	UFUNCTION(BlueprintImplementableEvent, Category = "Abyss")
 	void InvokeWinSequence();
 
+	// PredictedLevelData is what the previous board expected to come next. if it matches we reuse its seed.
 	UFUNCTION()
-	void InitializeMap(const int Level, const bool bParamIsAscending);
+	void InitializeMap(const int Level, const bool bParamIsAscending, const FMapLevelData& PredictedLevelData);
 
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Abyss")
 	TObjectPtr<USpawnDataAsset> SpawnDataAsset;
 
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Abyss")
-	TSubclassOf<AActor> DoorClass;
+	TSoftClassPtr<AActor> DoorClass;
 
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Abyss")
-	TSubclassOf<AActor> DoorFrameClass;
+	TSoftClassPtr<AActor> DoorFrameClass;
 
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Abyss")
 	float DoorScale = 10.f;
+
+	// builds the level layout on a worker thread and only commits it on the game thread.
+	// turn off to fall back to building the whole level synchronously.
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Abyss")
+	bool bGenerateLevelAsync = true;
+
+	// emit runs/rectangles of inner wall cells as single scaled instances instead of one instance per cell.
+	// far fewer instances and physics bodies on big levels. each merged wall still gets a random variant.
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Abyss")
+	bool bMergeInnerWalls = false;
+
+	// side length in maze cells of the chunks inner walls are split into. each chunk gets its own hierarchical
+	// instanced component per wall variant so culling and bounds updates stay local. 0 puts every wall
+	// straight into the MazeWallVariant components like before.
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Abyss", meta = (ClampMin = "0"))
+	int WallChunkSize = 16;
+
+	// per chunk wall components, indexed Chunk * MazeWallVariants.Num() + Variant. the MazeWallVariant
+	// components act as templates for these (mesh, materials, collision).
+	UPROPERTY(VisibleAnywhere, Transient, Category = "Abyss")
+	TArray<TObjectPtr<UHierarchicalInstancedStaticMeshComponent>> WallChunkComponents;
+
+	// keep the board and its wall instances between levels. each level then moves the existing instances
+	// into place and only adds/removes the difference instead of clearing and rebuilding everything.
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Abyss")
+	bool bRecycleInstances = false;
+
+	// pick the next level's seed as soon as this one is up and build it ahead of time.
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Abyss")
+	bool bPrebuildNextLevel = true;
+
+	// after each level is committed, precompute which cells can see which (within VisibilitySetRadius) on a worker
+	// thread. line of sight checks then become a bit test once it is ready.
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Abyss")
+	bool bBuildVisibilitySet = false;
+
+	// in cells. bigger costs build time and memory roughly with the square.
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Abyss", meta = (ClampMin = "1", ClampMax = "15"))
+	int VisibilitySetRadius = 12;
 protected:
 	UPROPERTY(Transient)
 	FRandomStream RandStream;
 	
-	TArray<FMapUnit> Maze;
-	TArray<FVector2d> ShuffledSpawnLocations;
+	FMazeGrid Maze;
+	// the level's spawn cells, handed over by the layout. used from SpawnTopIndex down and reshuffled in place once spent.
+	TArray<int32> SpawnCells;
 	int SpawnTopIndex = 0;
-	void ShuffleSpawnLocations()
+	// only for spawn placement and seeded from the level seed, so the server's spawns can be replayed from the seed.
+	FRandomStream SpawnRandStream;
+	void ShuffleSpawnCells()
 	{
-		ShuffledSpawnLocations.Empty();
-		for (int i = 0; i < Maze.Num(); i++)
+		FMazeCore::ShuffleCells(SpawnCells, [this](const int Min, const int Max)
 		{
-			if (Maze[i].bIsSpawn)
-			{
-				ShuffledSpawnLocations.Add(ConvertIndexToCoords(i));
-			}
-		}
-		int ShuffleIndex = ShuffledSpawnLocations.Num()-1;
-		while (ShuffleIndex >= 0)
-		{
-			const FVector2d Temp = ShuffledSpawnLocations[ShuffleIndex];
-			const int RandomPosition = FMath::RandRange(0,ShuffledSpawnLocations.Num()-1);
-			ShuffledSpawnLocations[ShuffleIndex] = ShuffledSpawnLocations[RandomPosition];
-			ShuffledSpawnLocations[RandomPosition] = Temp;
-			ShuffleIndex--;
-		}
-		SpawnTopIndex = ShuffledSpawnLocations.Num()-1;
+			return SpawnRandStream.RandRange(Min, Max);
+		});
+		SpawnTopIndex = SpawnCells.Num() - 1;
 	}
 
+	FLevelBuildStats LastBuildStats;
+
+	int ExitCell = INDEX_NONE;
+	FMazeDistanceField ExitDistanceField;
+	// one field per player pawn so a player moving only costs a BFS from that player.
+	TMap<TWeakObjectPtr<APawn>, FMazeDistanceField> PlayerDistanceFields;
+	FTimerHandle DistanceFieldTimerHandle;
+	void UpdatePlayerDistanceFields();
+
+	// asks USpawnClassPreloader for the current and predicted next level's classes and lets go of the rest.
+	void PreloadReachableLevels();
+
+	UFUNCTION()
+	void OnMonsterDestroyed(AActor* DestroyedActor);
+
+	// null until the background build for the current level is done.
+	TSharedPtr<const FMazeVisibilitySet, ESPMode::ThreadSafe> VisibilitySet;
+	void BuildVisibilitySet();
+
+	// bumped every build so a stale async layout never gets committed over a newer level.
+	int LevelBuildId = 0;
+
 	virtual void BeginPlay() override;
-	void GenerateMap();
-	void CarveSimpleMaze(const int X, const int Y);
-	void PlaceRandomRooms();
+	FMazeBuildParams MakeBuildParams() const;
+	void CommitLevelLayout(FMazeLayout& Layout);
+	void GenerateMap(const FMazeLayout& Layout);
+	UInstancedStaticMeshComponent* GetWallComponent(const int Bucket, const int NumWallChunks);
+	// doors, door frames and items come from the game mode's pool (server only) so levels don't churn actors.
+	UActorPoolComponent* GetActorPool() const;
+	AActor* SpawnPooledActor(TSubclassOf<AActor> ActorClass, const FTransform& Transform);
+	void ReleasePooledActor(AActor* Actor);
+	void CommitInstances(UInstancedStaticMeshComponent* Component, const TArray<FTransform>& Transforms, FInstanceCommitStats& Stats);
+	void PredictNextLevel();
+	void PrebuildNextLevel();
 	void ClearMazeCenter();
 	bool IsNearPlayerCharacter(const FVector& Location) const;
+	bool IsCellNearPlayerCharacter(const int Index) const;
 	void PopulateMazeWithObjects();
 	void CleanupMazeContents();
 
-	static int ModAdjust(int Val)
-	{
-		return (Val % 2 == 0) ? Val : (Val - 1);
-	}
-
 	FORCEINLINE int GetIndex(const int X, const int Y) const
 	{
-		return Y* CurrentMapLevelData.GetMazeDim() + X;
+		return FMazeCore::GetIndex(CurrentMapLevelData.GetMazeDim(), X, Y);
 	}
 
 	FORCEINLINE FVector2d ConvertIndexToCoords(int Index) const
 	{
-		return FVector2d(Index % CurrentMapLevelData.GetMazeDim(), Index / CurrentMapLevelData.GetMazeDim());
+		const FIntPoint Coords = FMazeCore::IndexToCoords(CurrentMapLevelData.GetMazeDim(), Index);
+		return FVector2d(Coords.X, Coords.Y);
 	}
 
 	FVector GetBaseOffset() const
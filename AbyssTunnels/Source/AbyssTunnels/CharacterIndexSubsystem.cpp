@@ -0,0 +1,156 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "CharacterIndexSubsystem.h"
+#include "AbyssTunnelsCharacter.h"
+#include "BoardGenerator.h"
+
+void FCharacterSnapshot::Reset()
+{
+	Characters.Reset();
+	X.Reset();
+	Y.Reset();
+	Z.Reset();
+	ForwardX.Reset();
+	ForwardY.Reset();
+	ForwardZ.Reset();
+	IsPlayer.Reset();
+	CellRanges.Reset();
+	PlayerEntries.Reset();
+	MonsterEntries.Reset();
+}
+
+UCharacterIndexSubsystem* UCharacterIndexSubsystem::Get(const UObject* WorldContextObject)
+{
+	if (const UWorld* World = GEngine->GetWorldFromContextObject(WorldContextObject, EGetWorldErrorMode::ReturnNull))
+	{
+		return World->GetSubsystem<UCharacterIndexSubsystem>();
+	}
+	return nullptr;
+}
+
+void UCharacterIndexSubsystem::RegisterCharacter(AAbyssTunnelsCharacter* Character)
+{
+	RegisteredCharacters.AddUnique(Character);
+	SnapshotFrame = MAX_uint64;
+}
+
+void UCharacterIndexSubsystem::UnregisterCharacter(AAbyssTunnelsCharacter* Character)
+{
+	RegisteredCharacters.RemoveSwap(Character);
+	SnapshotFrame = MAX_uint64;
+}
+
+void UCharacterIndexSubsystem::SetBoard(ABoardGenerator* InBoard)
+{
+	Board = InBoard;
+	CellOrigin = InBoard->ConvertUnitsToLocation(FVector2d::ZeroVector);
+	CellSize = InBoard->TerrainUnitSize * InBoard->CurrentMapLevelData.GetTerrainUnitSizeMultiplier();
+	SnapshotFrame = MAX_uint64;
+}
+
+void UCharacterIndexSubsystem::ClearBoard(ABoardGenerator* InBoard)
+{
+	if (Board.Get() == InBoard)
+	{
+		Board = nullptr;
+		SnapshotFrame = MAX_uint64;
+	}
+}
+
+void UCharacterIndexSubsystem::Deinitialize()
+{
+	RegisteredCharacters.Empty();
+	Snapshot.Reset();
+	Super::Deinitialize();
+}
+
+FIntPoint UCharacterIndexSubsystem::GetCell(const FVector& Location) const
+{
+	// rounded like ABoardGenerator::ConvertPositionToMazeIndex so the cells match the maze.
+	return FIntPoint(FMath::RoundToInt((Location.X - CellOrigin.X) / CellSize), FMath::RoundToInt((Location.Y - CellOrigin.Y) / CellSize));
+}
+
+const FCharacterSnapshot& UCharacterIndexSubsystem::GetSnapshot()
+{
+	if (SnapshotFrame != GFrameCounter)
+	{
+		RebuildSnapshot();
+		SnapshotFrame = GFrameCounter;
+	}
+	return Snapshot;
+}
+
+void UCharacterIndexSubsystem::RebuildSnapshot()
+{
+	struct FSortEntry
+	{
+		AAbyssTunnelsCharacter* Character;
+		FVector Location;
+		FIntPoint Cell;
+	};
+	TArray<FSortEntry, TInlineAllocator<64>> Entries;
+	for (int i = RegisteredCharacters.Num() - 1; i >= 0; --i)
+	{
+		AAbyssTunnelsCharacter* Character = RegisteredCharacters[i].Get();
+		if (!IsValid(Character))
+		{
+			RegisteredCharacters.RemoveAtSwap(i);
+			continue;
+		}
+		const FVector Location = Character->GetActorLocation();
+		Entries.Add({ Character, Location, GetCell(Location) });
+	}
+	Entries.Sort([](const FSortEntry& A, const FSortEntry& B)
+	{
+		return A.Cell.Y != B.Cell.Y ? A.Cell.Y < B.Cell.Y : A.Cell.X < B.Cell.X;
+	});
+
+	Snapshot.Reset();
+	const int Num = Entries.Num();
+	Snapshot.Characters.Reserve(Num);
+	Snapshot.X.Reserve(Num);
+	Snapshot.Y.Reserve(Num);
+	Snapshot.Z.Reserve(Num);
+	Snapshot.ForwardX.Reserve(Num);
+	Snapshot.ForwardY.Reserve(Num);
+	Snapshot.ForwardZ.Reserve(Num);
+	Snapshot.IsPlayer.Reserve(Num);
+	for (int Entry = 0; Entry < Num; ++Entry)
+	{
+		const FSortEntry& Source = Entries[Entry];
+		const FVector Forward = Source.Character->GetActorForwardVector();
+		const bool bIsPlayer = Source.Character->IsPlayerControlled();
+		Snapshot.Characters.Add(Source.Character);
+		Snapshot.X.Add(Source.Location.X);
+		Snapshot.Y.Add(Source.Location.Y);
+		Snapshot.Z.Add(Source.Location.Z);
+		Snapshot.ForwardX.Add(Forward.X);
+		Snapshot.ForwardY.Add(Forward.Y);
+		Snapshot.ForwardZ.Add(Forward.Z);
+		Snapshot.IsPlayer.Add(bIsPlayer);
+		(bIsPlayer ? Snapshot.PlayerEntries : Snapshot.MonsterEntries).Add(Entry);
+		TPair<int32, int32>& Range = Snapshot.CellRanges.FindOrAdd(Source.Cell, TPair<int32, int32>(Entry, 0));
+		Range.Value++;
+	}
+}
+
+bool UCharacterIndexSubsystem::AnyInRadius(const FVector& Location, const float Radius, const ECharacterIndexFilter Filter)
+{
+	bool bFound = false;
+	ForEachInRadius(Location, Radius, Filter, [&bFound](const int Entry)
+	{
+		bFound = true;
+	});
+	return bFound;
+}
+
+int UCharacterIndexSubsystem::CountInRadius(const FVector& Location, const float Radius, const ECharacterIndexFilter Filter)
+{
+	int Count = 0;
+	ForEachInRadius(Location, Radius, Filter, [&Count](const int Entry)
+	{
+		Count++;
+	});
+	return Count;
+}
@@ -0,0 +1,118 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "CharacterIndexSubsystem.generated.h"
+
+class AAbyssTunnelsCharacter;
+class ABoardGenerator;
+
+enum class ECharacterIndexFilter : uint8
+{
+	Players,
+	Monsters,
+	Any
+};
+
+/**
+ * Positions of every character this frame, struct of arrays and sorted by maze cell so a neighbourhood query only
+ * touches the cells around it. Rebuilt lazily the first time it is asked for in a frame, so everything reading it
+ * within a frame sees the same positions.
+ */
+struct FCharacterSnapshot
+{
+	// entry i of every array is the same character. only valid for the frame the snapshot was taken in.
+	TArray<AAbyssTunnelsCharacter*> Characters;
+	TArray<float> X;
+	TArray<float> Y;
+	TArray<float> Z;
+	TArray<float> ForwardX;
+	TArray<float> ForwardY;
+	TArray<float> ForwardZ;
+	TArray<bool> IsPlayer;
+	// first entry and count for each occupied cell. entries of one cell are contiguous.
+	TMap<FIntPoint, TPair<int32, int32>> CellRanges;
+	TArray<int32> PlayerEntries;
+	TArray<int32> MonsterEntries;
+
+	void Reset();
+	FORCEINLINE int Num() const { return Characters.Num(); }
+	FORCEINLINE FVector GetLocation(const int Entry) const { return FVector(X[Entry], Y[Entry], Z[Entry]); }
+	FORCEINLINE FVector GetForward(const int Entry) const { return FVector(ForwardX[Entry], ForwardY[Entry], ForwardZ[Entry]); }
+};
+
+UCLASS()
+class ABYSSTUNNELS_API UCharacterIndexSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+public:
+	static UCharacterIndexSubsystem* Get(const UObject* WorldContextObject);
+
+	// characters add themselves on BeginPlay and remove themselves on EndPlay.
+	void RegisterCharacter(AAbyssTunnelsCharacter* Character);
+	void UnregisterCharacter(AAbyssTunnelsCharacter* Character);
+
+	// cells line up with the board's maze cells while there is a board, otherwise it falls back to a plain world grid.
+	void SetBoard(ABoardGenerator* InBoard);
+	void ClearBoard(ABoardGenerator* InBoard);
+
+	const FCharacterSnapshot& GetSnapshot();
+	FIntPoint GetCell(const FVector& Location) const;
+
+	// calls Callback(Entry) for every matching character within Radius (3d distance) of Location.
+	template<typename FuncType>
+	void ForEachInRadius(const FVector& Location, const float Radius, const ECharacterIndexFilter Filter, FuncType&& Callback)
+	{
+		const FCharacterSnapshot& Snap = GetSnapshot();
+		if (Snap.Num() == 0)
+		{
+			return;
+		}
+		const FIntPoint Center = GetCell(Location);
+		const int CellRadius = FMath::CeilToInt(Radius / CellSize);
+		const float RadiusSquared = Radius * Radius;
+		for (int CellY = Center.Y - CellRadius; CellY <= Center.Y + CellRadius; ++CellY)
+		{
+			for (int CellX = Center.X - CellRadius; CellX <= Center.X + CellRadius; ++CellX)
+			{
+				const TPair<int32, int32>* Range = Snap.CellRanges.Find(FIntPoint(CellX, CellY));
+				if (!Range)
+				{
+					continue;
+				}
+				for (int Entry = Range->Key; Entry < Range->Key + Range->Value; ++Entry)
+				{
+					if ((Filter == ECharacterIndexFilter::Players && !Snap.IsPlayer[Entry]) || (Filter == ECharacterIndexFilter::Monsters && Snap.IsPlayer[Entry]))
+					{
+						continue;
+					}
+					const float DX = Snap.X[Entry] - Location.X;
+					const float DY = Snap.Y[Entry] - Location.Y;
+					const float DZ = Snap.Z[Entry] - Location.Z;
+					if (DX * DX + DY * DY + DZ * DZ <= RadiusSquared)
+					{
+						Callback(Entry);
+					}
+				}
+			}
+		}
+	}
+
+	bool AnyInRadius(const FVector& Location, const float Radius, const ECharacterIndexFilter Filter);
+	int CountInRadius(const FVector& Location, const float Radius, const ECharacterIndexFilter Filter);
+
+	virtual void Deinitialize() override;
+
+protected:
+	void RebuildSnapshot();
+
+	TArray<TWeakObjectPtr<AAbyssTunnelsCharacter>> RegisteredCharacters;
+	FCharacterSnapshot Snapshot;
+	uint64 SnapshotFrame = MAX_uint64;
+	// world position of the center of cell 0,0 and the cell size.
+	FVector CellOrigin = FVector::ZeroVector;
+	float CellSize = 400.f;
+	TWeakObjectPtr<ABoardGenerator> Board;
+};
@@ -0,0 +1,195 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "DecalManagerComponent.h"
+#include "AbyssTunnelsGameState.h"
+#include "Components/DecalComponent.h"
+#include "Kismet/GameplayStatics.h"
+#include "Net/UnrealNetwork.h"
+
+bool FDecalBatch::AddMaterial(UMaterialInterface* Material, uint8& OutIndex)
+{
+	int Index = Materials.IndexOfByKey(Material);
+	if (Index == INDEX_NONE)
+	{
+		if (Materials.Num() > MAX_uint8)
+		{
+			return false;
+		}
+		Index = Materials.Add(Material);
+	}
+	OutIndex = static_cast<uint8>(Index);
+	return true;
+}
+
+UDecalManagerComponent::UDecalManagerComponent()
+{
+	PrimaryComponentTick.bCanEverTick = true;
+	// only ticks while the server has decals queued.
+	PrimaryComponentTick.bStartWithTickEnabled = false;
+	SetIsReplicatedByDefault(true);
+}
+
+void UDecalManagerComponent::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+	// everyone already connected hears about new decals through the multicasts.
+	DOREPLIFETIME_CONDITION(UDecalManagerComponent, Snapshot, COND_InitialOnly);
+	DOREPLIFETIME_CONDITION(UDecalManagerComponent, SnapshotHead, COND_InitialOnly);
+}
+
+UDecalManagerComponent* UDecalManagerComponent::Get(const UObject* WorldContextObject)
+{
+	AAbyssTunnelsGameState* GameState = AAbyssTunnelsGameState::Get(WorldContextObject);
+	return GameState ? GameState->DecalManager : nullptr;
+}
+
+void UDecalManagerComponent::AddDecal(UMaterialInterface* DecalMaterial, const FVector& DecalSize, const FVector& Location, const FRotator& Rotation)
+{
+	if (!GetOwner() || !GetOwner()->HasAuthority() || !DecalMaterial || MaxDecals <= 0)
+	{
+		return;
+	}
+	FDecalRecord Record;
+	Record.Location = Location;
+	Record.Size = DecalSize;
+	Record.Rotation = Rotation;
+	if (!PendingBatch.AddMaterial(DecalMaterial, Record.MaterialIndex))
+	{
+		UE_LOG(LogTemp, Warning, TEXT("AddDecal: too many different decal materials in one frame, dropping %s"), *GetNameSafe(DecalMaterial));
+		return;
+	}
+	PendingBatch.Decals.Add(Record);
+
+	uint8 SnapshotMaterialIndex = 0;
+	if (Snapshot.AddMaterial(DecalMaterial, SnapshotMaterialIndex))
+	{
+		Record.MaterialIndex = SnapshotMaterialIndex;
+		if (Snapshot.Decals.Num() < MaxDecals)
+		{
+			Snapshot.Decals.Add(Record);
+		}
+		else
+		{
+			// full, overwrite the oldest.
+			SnapshotHead %= Snapshot.Decals.Num();
+			Snapshot.Decals[SnapshotHead] = Record;
+			SnapshotHead = (SnapshotHead + 1) % Snapshot.Decals.Num();
+		}
+	}
+	SetComponentTickEnabled(true);
+}
+
+void UDecalManagerComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+	if (PendingBatch.Decals.Num() <= MaxDecalsPerBatch)
+	{
+		if (PendingBatch.Decals.Num() > 0)
+		{
+			MulticastAddDecals(PendingBatch);
+		}
+		PendingBatch.Decals.Reset();
+		PendingBatch.Materials.Reset();
+		SetComponentTickEnabled(false);
+		return;
+	}
+	// the material table is tiny so the split batch just carries all of it.
+	FDecalBatch Batch;
+	Batch.Materials = PendingBatch.Materials;
+	Batch.Decals.Append(PendingBatch.Decals.GetData(), MaxDecalsPerBatch);
+	PendingBatch.Decals.RemoveAt(0, MaxDecalsPerBatch, false);
+	MulticastAddDecals(Batch);
+}
+
+void UDecalManagerComponent::MulticastAddDecals_Implementation(const FDecalBatch& Batch)
+{
+	SpawnBatchLocally(Batch);
+}
+
+void UDecalManagerComponent::OnRep_Snapshot()
+{
+	SpawnBatchLocally(Snapshot, SnapshotHead);
+}
+
+void UDecalManagerComponent::SpawnBatchLocally(const FDecalBatch& Batch, const int FirstDecal)
+{
+	const int NumDecals = Batch.Decals.Num();
+	for (int i = 0; i < NumDecals; ++i)
+	{
+		const FDecalRecord& Record = Batch.Decals[(FirstDecal + i) % NumDecals];
+		if (Batch.Materials.IsValidIndex(Record.MaterialIndex))
+		{
+			SpawnDecalLocally(Batch.Materials[Record.MaterialIndex], Record.Size, Record.Location, Record.Rotation);
+		}
+	}
+}
+
+void UDecalManagerComponent::SpawnDecalLocally(UMaterialInterface* DecalMaterial, const FVector& DecalSize, const FVector& Location, const FRotator& Rotation)
+{
+	if (!DecalMaterial || MaxDecals <= 0 || GetNetMode() == NM_DedicatedServer)
+	{
+		return;
+	}
+	if (NextPooledDecal >= MaxDecals)
+	{
+		NextPooledDecal = 0;
+	}
+	const int Slot = NextPooledDecal;
+	NextPooledDecal = (NextPooledDecal + 1) % MaxDecals;
+	if (PooledDecals.IsValidIndex(Slot) && IsValid(PooledDecals[Slot]))
+	{
+		UDecalComponent* Decal = PooledDecals[Slot];
+		Decal->SetDecalMaterial(DecalMaterial);
+		Decal->DecalSize = DecalSize;
+		Decal->SetWorldLocationAndRotation(Location, Rotation);
+		Decal->SetVisibility(true);
+		Decal->MarkRenderStateDirty();
+		return;
+	}
+	UDecalComponent* Decal = UGameplayStatics::SpawnDecalAtLocation(this, DecalMaterial, DecalSize, Location, Rotation);
+	if (!Decal)
+	{
+		NextPooledDecal = Slot;
+		return;
+	}
+	if (PooledDecals.IsValidIndex(Slot))
+	{
+		PooledDecals[Slot] = Decal;
+	}
+	else
+	{
+		PooledDecals.Add(Decal);
+	}
+}
+
+void UDecalManagerComponent::ClearDecals()
+{
+	for (UDecalComponent* Decal : PooledDecals)
+	{
+		if (IsValid(Decal))
+		{
+			Decal->SetVisibility(false);
+		}
+	}
+	NextPooledDecal = 0;
+	if (GetOwner() && GetOwner()->HasAuthority())
+	{
+		Snapshot.Decals.Reset();
+		Snapshot.Materials.Reset();
+		SnapshotHead = 0;
+	}
+}
+
+void UDecalManagerComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	for (UDecalComponent* Decal : PooledDecals)
+	{
+		if (IsValid(Decal))
+		{
+			Decal->DestroyComponent();
+		}
+	}
+	PooledDecals.Empty();
+	Super::EndPlay(EndPlayReason);
+}
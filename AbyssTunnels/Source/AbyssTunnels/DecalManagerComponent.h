@@ -0,0 +1,111 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+#include "Engine/NetSerialization.h"
+#include "DecalManagerComponent.generated.h"
+
+class UDecalComponent;
+class UMaterialInterface;
+
+// one decal on the wire. the material is an index into the batch's material table so it isn't resent per decal.
+USTRUCT()
+struct FDecalRecord
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	FVector_NetQuantize Location = FVector::ZeroVector;
+
+	UPROPERTY()
+	FVector_NetQuantize Size = FVector::ZeroVector;
+
+	// FRotator already goes over the wire as compressed shorts.
+	UPROPERTY()
+	FRotator Rotation = FRotator::ZeroRotator;
+
+	UPROPERTY()
+	uint8 MaterialIndex = 0;
+};
+
+USTRUCT()
+struct FDecalBatch
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	TArray<TObjectPtr<UMaterialInterface>> Materials;
+
+	UPROPERTY()
+	TArray<FDecalRecord> Decals;
+
+	// returns false once the table is full.
+	bool AddMaterial(UMaterialInterface* Material, uint8& OutIndex);
+};
+
+// every decal in the game goes through here instead of a reliable multicast each.
+// the server queues decals and sends them once a frame in an unreliable multicast, everyone draws them with a fixed
+// pool of components that gets recycled oldest first. late joiners get the last MaxDecals through a snapshot that is
+// only replicated on the initial bunch.
+UCLASS(ClassGroup=(Abyss), meta=(BlueprintSpawnableComponent))
+class ABYSSTUNNELS_API UDecalManagerComponent : public UActorComponent
+{
+	GENERATED_BODY()
+
+public:
+	UDecalManagerComponent();
+
+	// server only.
+	UFUNCTION(BlueprintCallable, BlueprintAuthorityOnly, Category = "Abyss")
+	void AddDecal(UMaterialInterface* DecalMaterial, const FVector& DecalSize, const FVector& Location, const FRotator& Rotation);
+
+	// hides every pooled decal. the components are kept for the next level. on the server this also empties the snapshot.
+	UFUNCTION(BlueprintCallable, Category = "Abyss")
+	void ClearDecals();
+
+	UFUNCTION(BlueprintPure, Category = "Abyss", meta = (WorldContext = "WorldContextObject"))
+	static UDecalManagerComponent* Get(const UObject* WorldContextObject);
+
+	// size of the component pool and of the late joiner snapshot. past this the oldest decal gets reused.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Abyss")
+	int MaxDecals = 128;
+
+	// most decals sent in one multicast, anything over waits for the next frame.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Abyss")
+	int MaxDecalsPerBatch = 32;
+
+	virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+
+protected:
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	UFUNCTION(NetMulticast, Unreliable)
+	void MulticastAddDecals(const FDecalBatch& Batch);
+
+	UFUNCTION()
+	void OnRep_Snapshot();
+
+	// FirstDecal lets the snapshot ring be replayed oldest first.
+	void SpawnBatchLocally(const FDecalBatch& Batch, const int FirstDecal = 0);
+	void SpawnDecalLocally(UMaterialInterface* DecalMaterial, const FVector& DecalSize, const FVector& Location, const FRotator& Rotation);
+
+	// the last MaxDecals on the server as a ring starting at SnapshotHead. only sent when a client first gets the actor.
+	UPROPERTY(ReplicatedUsing = OnRep_Snapshot)
+	FDecalBatch Snapshot;
+
+	UPROPERTY(Replicated)
+	int SnapshotHead = 0;
+
+	// queued on the server until the next tick.
+	UPROPERTY(Transient)
+	FDecalBatch PendingBatch;
+
+	// local ring of decal components, NextPooledDecal is the oldest once the pool is full.
+	UPROPERTY(Transient)
+	TArray<TObjectPtr<UDecalComponent>> PooledDecals;
+
+	int NextPooledDecal = 0;
+};
@@ -5,7 +5,106 @@
 
 #include "Components/InstancedStaticMeshComponent.h"
 #include "Net/UnrealNetwork.h"
+#include "Engine/NetSerialization.h"
 
+static TAutoConsoleVariable<int32> CVarInstanceNetPrecision(
+	TEXT("Abyss.InstanceNetPrecision"),
+	0,
+	TEXT("Location precision of replicated mesh instances. 0 = 1cm, 1 = 0.1cm, 2 = 0.01cm. Sent along with each instance so server and clients don't have to agree."));
+
+namespace InstanceNetFlags
+{
+	// the low two bits are the location precision.
+	constexpr uint8 PrecisionMask = 0x3;
+	constexpr uint8 YawOnly = 1 << 2;
+	constexpr uint8 UniformScale = 1 << 3;
+	constexpr uint8 UnitScale = 1 << 4;
+	constexpr uint32 NumBits = 5;
+}
+
+bool FInstanceEntryData::NetSerialize(FArchive& Ar, UPackageMap* Map, bool& bOutSuccess)
+{
+	bOutSuccess = true;
+	uint32 PackedId = static_cast<uint32>(Index);
+	Ar.SerializeIntPacked(PackedId);
+	Index = static_cast<int32>(PackedId);
+
+	FVector Location = InstanceTransform.GetLocation();
+	FRotator Rotation = InstanceTransform.Rotator();
+	FVector Scale = InstanceTransform.GetScale3D();
+	uint8 Flags = 0;
+	if (Ar.IsSaving())
+	{
+		Flags = static_cast<uint8>(FMath::Clamp(CVarInstanceNetPrecision.GetValueOnAnyThread(), 0, 2));
+		Flags |= FMath::IsNearlyZero(Rotation.Pitch, 0.01) && FMath::IsNearlyZero(Rotation.Roll, 0.01) ? InstanceNetFlags::YawOnly : 0;
+		Flags |= Scale.AllComponentsEqual(KINDA_SMALL_NUMBER) ? InstanceNetFlags::UniformScale : 0;
+		Flags |= Scale.Equals(FVector::OneVector, KINDA_SMALL_NUMBER) ? InstanceNetFlags::UnitScale : 0;
+	}
+	Ar.SerializeBits(&Flags, InstanceNetFlags::NumBits);
+
+	switch (Flags & InstanceNetFlags::PrecisionMask)
+	{
+		case 0: bOutSuccess &= SerializePackedVector<1, 24>(Location, Ar); break;
+		case 1: bOutSuccess &= SerializePackedVector<10, 27>(Location, Ar); break;
+		default: bOutSuccess &= SerializePackedVector<100, 30>(Location, Ar); break;
+	}
+
+	if (Flags & InstanceNetFlags::YawOnly)
+	{
+		uint16 Yaw = FRotator::CompressAxisToShort(Rotation.Yaw);
+		Ar << Yaw;
+		Rotation = FRotator(0, FRotator::DecompressAxisFromShort(Yaw), 0);
+	}
+	else
+	{
+		Rotation.SerializeCompressedShort(Ar);
+	}
+
+	if (Flags & InstanceNetFlags::UnitScale)
+	{
+		Scale = FVector::OneVector;
+	}
+	else if (Flags & InstanceNetFlags::UniformScale)
+	{
+		float UniformScale = Scale.X;
+		Ar << UniformScale;
+		Scale = FVector(UniformScale);
+	}
+	else
+	{
+		bOutSuccess &= SerializePackedVector<100, 30>(Scale, Ar);
+	}
+
+	if (Ar.IsLoading())
+	{
+		InstanceTransform = FTransform(Rotation, Location, Scale);
+	}
+	return true;
+}
+
+void FInstanceEntryData::PreReplicatedRemove(const FInstanceEntryArray& InArraySerializer)
+{
+	if (InArraySerializer.Owner)
+	{
+		InArraySerializer.Owner->RemoveLocalInstance(Index);
+	}
+}
+
+void FInstanceEntryData::PostReplicatedAdd(const FInstanceEntryArray& InArraySerializer)
+{
+	if (InArraySerializer.Owner)
+	{
+		InArraySerializer.Owner->AddLocalInstance(Index, InstanceTransform);
+	}
+}
+
+void FInstanceEntryData::PostReplicatedChange(const FInstanceEntryArray& InArraySerializer)
+{
+	if (InArraySerializer.Owner)
+	{
+		InArraySerializer.Owner->UpdateLocalInstance(Index, InstanceTransform);
+	}
+}
 
 // Sets default values
 AInstancedMeshActor::AInstancedMeshActor()
@@ -20,37 +119,130 @@ AInstancedMeshActor::AInstancedMeshActor()
 	if (InstancedStaticMeshComponent)
 	{
 		InstancedStaticMeshComponent->SetupAttachment(Root);
+		// removal moves the last instance into the hole instead of shifting everything after it down.
+		InstancedStaticMeshComponent->bSupportRemoveAtSwap = true;
 	}
 }
 
+void AInstancedMeshActor::PostInitializeComponents()
+{
+	Super::PostInitializeComponents();
+	Instances.Owner = this;
+}
+
 void AInstancedMeshActor::GetLifetimeReplicatedProps(TArray< FLifetimeProperty >& OutLifetimeProps) const
 {
 	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
 	DOREPLIFETIME(AInstancedMeshActor, Instances);
 }
 
-void AInstancedMeshActor::OnRep_Instances()
+void AInstancedMeshActor::AddLocalInstance(const int32 InstanceId, const FTransform& Transform)
 {
-	for (FInstanceEntryData& Instance : Instances)
+	if (InstanceIdToLocalIndex.Contains(InstanceId))
+	{
+		UpdateLocalInstance(InstanceId, Transform);
+		return;
+	}
+	const int32 LocalIndex = InstancedStaticMeshComponent->AddInstance(Transform, true);
+	InstanceIdToLocalIndex.Add(InstanceId, LocalIndex);
+	if (LocalIndexToInstanceId.Num() <= LocalIndex)
+	{
+		LocalIndexToInstanceId.SetNum(LocalIndex + 1);
+	}
+	LocalIndexToInstanceId[LocalIndex] = InstanceId;
+}
+
+void AInstancedMeshActor::RemoveLocalInstance(const int32 InstanceId)
+{
+	int32 LocalIndex;
+	if (!InstanceIdToLocalIndex.RemoveAndCopyValue(InstanceId, LocalIndex))
+	{
+		return;
+	}
+	InstancedStaticMeshComponent->RemoveInstance(LocalIndex);
+	// mirror what the component just did to its instances.
+	if (InstancedStaticMeshComponent->bSupportRemoveAtSwap)
+	{
+		LocalIndexToInstanceId.RemoveAtSwap(LocalIndex);
+		if (LocalIndexToInstanceId.IsValidIndex(LocalIndex))
+		{
+			InstanceIdToLocalIndex[LocalIndexToInstanceId[LocalIndex]] = LocalIndex;
+		}
+	}
+	else
 	{
-		if (!ServerInstanceIndexToLocalIndexInstanceMap.Contains(Instance.Index))
+		LocalIndexToInstanceId.RemoveAt(LocalIndex);
+		for (int32 i = LocalIndex; i < LocalIndexToInstanceId.Num(); ++i)
 		{
-			int32 ClientIndex = InstancedStaticMeshComponent->AddInstance(Instance.InstanceTransform, true);
-			ServerInstanceIndexToLocalIndexInstanceMap.Add(Instance.Index, ClientIndex);
+			InstanceIdToLocalIndex[LocalIndexToInstanceId[i]] = i;
 		}
 	}
 }
 
-void AInstancedMeshActor::AddInstance(const FTransform& NewInstanceTransform)
+void AInstancedMeshActor::UpdateLocalInstance(const int32 InstanceId, const FTransform& Transform)
+{
+	if (const int32* LocalIndex = InstanceIdToLocalIndex.Find(InstanceId))
+	{
+		InstancedStaticMeshComponent->UpdateInstanceTransform(*LocalIndex, Transform, true, true);
+	}
+}
+
+int32 AInstancedMeshActor::AddInstance(const FTransform& NewInstanceTransform)
 {
 	if (!HasAuthority())
 	{
 		UE_LOG(LogTemp, Error, TEXT("AddInstance -- This only should happen on authority"));
-		return;
+		return INDEX_NONE;
 	}
 	FInstanceEntryData NewEntry;
 	NewEntry.InstanceTransform = NewInstanceTransform;
-	NewEntry.Index = InstancedStaticMeshComponent->AddInstance(NewInstanceTransform, true);
+	NewEntry.Index = NextInstanceId++;
+	AddLocalInstance(NewEntry.Index, NewInstanceTransform);
+	FlushNetDormancy();
+	InstanceIdToItemIndex.Add(NewEntry.Index, Instances.Items.Num());
+	Instances.MarkItemDirty(Instances.Items.Add_GetRef(NewEntry));
+	return NewEntry.Index;
+}
+
+bool AInstancedMeshActor::RemoveInstance(const int32 InstanceId)
+{
+	if (!HasAuthority())
+	{
+		UE_LOG(LogTemp, Error, TEXT("RemoveInstance -- This only should happen on authority"));
+		return false;
+	}
+	int32 ItemIndex;
+	if (!InstanceIdToItemIndex.RemoveAndCopyValue(InstanceId, ItemIndex))
+	{
+		return false;
+	}
+	RemoveLocalInstance(InstanceId);
+	FlushNetDormancy();
+	Instances.Items.RemoveAtSwap(ItemIndex);
+	if (Instances.Items.IsValidIndex(ItemIndex))
+	{
+		InstanceIdToItemIndex[Instances.Items[ItemIndex].Index] = ItemIndex;
+	}
+	Instances.MarkArrayDirty();
+	return true;
+}
+
+bool AInstancedMeshActor::UpdateInstanceTransform(const int32 InstanceId, const FTransform& NewInstanceTransform)
+{
+	if (!HasAuthority())
+	{
+		UE_LOG(LogTemp, Error, TEXT("UpdateInstanceTransform -- This only should happen on authority"));
+		return false;
+	}
+	const int32* ItemIndex = InstanceIdToItemIndex.Find(InstanceId);
+	if (!ItemIndex)
+	{
+		return false;
+	}
+	UpdateLocalInstance(InstanceId, NewInstanceTransform);
 	FlushNetDormancy();
-	Instances.Add(NewEntry);
+	FInstanceEntryData& Item = Instances.Items[*ItemIndex];
+	Item.InstanceTransform = NewInstanceTransform;
+	Instances.MarkItemDirty(Item);
+	return true;
 }
@@ -4,25 +4,74 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/Actor.h"
+#include "Net/Serialization/FastArraySerializer.h"
 #include "InstancedMeshActor.generated.h"
 
 class UInstancedStaticMeshComponent;
 class USceneComponent;
+class AInstancedMeshActor;
+struct FInstanceEntryArray;
 
 USTRUCT()
-struct FInstanceEntryData
+struct FInstanceEntryData : public FFastArraySerializerItem
 {
 	GENERATED_BODY()
 
+	// stable id handed out by the server. not the component instance index, those move around on removal.
 	UPROPERTY()
-	int32 Index;
+	int32 Index = INDEX_NONE;
 
 	UPROPERTY()
 	FTransform InstanceTransform;
+
+	void PreReplicatedRemove(const FInstanceEntryArray& InArraySerializer);
+	void PostReplicatedAdd(const FInstanceEntryArray& InArraySerializer);
+	void PostReplicatedChange(const FInstanceEntryArray& InArraySerializer);
+
+	// quantized instead of a full transform: location at Abyss.InstanceNetPrecision, yaw only rotation as 16 bits when
+	// pitch and roll are zero (anything on the maze floor), and scale dropped or sent as one float when it is uniform.
+	bool NetSerialize(FArchive& Ar, UPackageMap* Map, bool& bOutSuccess);
+};
+
+template<>
+struct TStructOpsTypeTraits<FInstanceEntryData> : public TStructOpsTypeTraitsBase2<FInstanceEntryData>
+{
+	enum
+	{
+		WithNetSerializer = true,
+	};
+};
+
+// only the entries that were added, changed or removed since the last update go over the wire.
+USTRUCT()
+struct FInstanceEntryArray : public FFastArraySerializer
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	TArray<FInstanceEntryData> Items;
+
+	// not replicated or saved, the owning actor sets it in PostInitializeComponents so item callbacks can reach it.
+	UPROPERTY(Transient, NotReplicated)
+	TObjectPtr<AInstancedMeshActor> Owner;
+
+	bool NetDeltaSerialize(FNetDeltaSerializeInfo& DeltaParms)
+	{
+		return FFastArraySerializer::FastArrayDeltaSerialize<FInstanceEntryData, FInstanceEntryArray>(Items, DeltaParms, *this);
+	}
+};
+
+template<>
+struct TStructOpsTypeTraits<FInstanceEntryArray> : public TStructOpsTypeTraitsBase2<FInstanceEntryArray>
+{
+	enum
+	{
+		WithNetDeltaSerializer = true,
+	};
 };
 
 // a quick generic actor with an instanced static mesh component on it.
-// can use it from server to tell all clients to add a new instance locally.
+// can use it from server to tell all clients to add, move or remove instances locally.
 UCLASS()
 class ABYSSTUNNELS_API AInstancedMeshActor : public AActor
 {
@@ -38,16 +87,32 @@ public:
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
 	TObjectPtr<UInstancedStaticMeshComponent> InstancedStaticMeshComponent;
 
-	UPROPERTY(ReplicatedUsing=OnRep_Instances);
-	TArray<FInstanceEntryData> Instances;
-	
-	TMap<int32, int32> ServerInstanceIndexToLocalIndexInstanceMap;
-
-	UFUNCTION()
-	void OnRep_Instances();
+	UPROPERTY(Replicated)
+	FInstanceEntryArray Instances;
 	
 	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+	virtual void PostInitializeComponents() override;
 	
+	// returns the id to use with RemoveInstance/UpdateInstanceTransform.
 	UFUNCTION(BlueprintCallable, Category = "Abyss")
-	void AddInstance(const FTransform& NewInstanceTransform);
+	int32 AddInstance(const FTransform& NewInstanceTransform);
+
+	UFUNCTION(BlueprintCallable, Category = "Abyss")
+	bool RemoveInstance(const int32 InstanceId);
+
+	UFUNCTION(BlueprintCallable, Category = "Abyss")
+	bool UpdateInstanceTransform(const int32 InstanceId, const FTransform& NewInstanceTransform);
+
+	// local component side, used by the server directly and by the replication callbacks on clients.
+	void AddLocalInstance(const int32 InstanceId, const FTransform& Transform);
+	void RemoveLocalInstance(const int32 InstanceId);
+	void UpdateLocalInstance(const int32 InstanceId, const FTransform& Transform);
+
+protected:
+	// instance id -> component instance index, and back. kept in sync as the component swaps instances on removal.
+	TMap<int32, int32> InstanceIdToLocalIndex;
+	TArray<int32> LocalIndexToInstanceId;
+	// server only: instance id -> position in Instances.Items.
+	TMap<int32, int32> InstanceIdToItemIndex;
+	int32 NextInstanceId = 0;
 };
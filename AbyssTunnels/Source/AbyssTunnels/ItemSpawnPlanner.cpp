@@ -0,0 +1,165 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ItemSpawnPlanner.h"
+
+void FSpawnAliasSampler::Build(const TArray<int32>& InEntries, const TArray<float>& Weights)
+{
+	Entries.Reset();
+	double TotalWeight = 0.0;
+	for (const int32 Entry : InEntries)
+	{
+		if (Weights[Entry] > 0.f)
+		{
+			Entries.Add(Entry);
+			TotalWeight += Weights[Entry];
+		}
+	}
+	const int Num = Entries.Num();
+	Probability.SetNumUninitialized(Num);
+	Alias.SetNumUninitialized(Num);
+	if (Num == 0)
+	{
+		return;
+	}
+	// vose: scale so the average column is 1, then pair each under full column with an over full one.
+	TArray<double> Scaled;
+	Scaled.SetNumUninitialized(Num);
+	TArray<int32> Small;
+	TArray<int32> Large;
+	for (int i = 0; i < Num; ++i)
+	{
+		Scaled[i] = Weights[Entries[i]] * Num / TotalWeight;
+		Alias[i] = i;
+		(Scaled[i] < 1.0 ? Small : Large).Add(i);
+	}
+	while (Small.Num() > 0 && Large.Num() > 0)
+	{
+		const int32 Less = Small.Pop(false);
+		const int32 More = Large.Pop(false);
+		Probability[Less] = Scaled[Less];
+		Alias[Less] = More;
+		Scaled[More] = (Scaled[More] + Scaled[Less]) - 1.0;
+		(Scaled[More] < 1.0 ? Small : Large).Add(More);
+	}
+	// whatever is left is full up to rounding.
+	for (const int32 Column : Large)
+	{
+		Probability[Column] = 1.f;
+	}
+	for (const int32 Column : Small)
+	{
+		Probability[Column] = 1.f;
+	}
+}
+
+void FItemSpawnPlanner::Compile(const TArray<FSpawnTableEntry>& SpawnTable, const int Level)
+{
+	Eligible.Reset();
+	Required.Reset();
+	Unique.Init(false, SpawnTable.Num());
+	DeadEndAllowed.Init(false, SpawnTable.Num());
+	Weights.SetNumZeroed(SpawnTable.Num());
+	for (int i = 0; i < SpawnTable.Num(); ++i)
+	{
+		const FSpawnTableEntry& Entry = SpawnTable[i];
+		if (Entry.MinimumLevel > Level || Entry.MaximumLevel < Level || Entry.SpawnableObjectClass.IsNull())
+		{
+			continue;
+		}
+		Eligible.Add(i);
+		Weights[i] = FMath::Max(Entry.SpawnChance, 0.f);
+		Unique[i] = Entry.bLevelUnique;
+		DeadEndAllowed[i] = Entry.bCanSpawnInDeadEnds;
+		if (Entry.bLevelRequired)
+		{
+			Required.Add(i);
+		}
+	}
+	BuildSamplers(TBitArray<>(false, SpawnTable.Num()), RoomSampler, DeadEndSampler);
+}
+
+void FItemSpawnPlanner::BuildSamplers(const TBitArray<>& Excluded, FSpawnAliasSampler& OutRoomSampler, FSpawnAliasSampler& OutDeadEndSampler) const
+{
+	TArray<int32> RoomEntries;
+	TArray<int32> DeadEndEntries;
+	for (const int32 Entry : Eligible)
+	{
+		if (Excluded[Entry])
+		{
+			continue;
+		}
+		RoomEntries.Add(Entry);
+		if (DeadEndAllowed[Entry])
+		{
+			DeadEndEntries.Add(Entry);
+		}
+	}
+	OutRoomSampler.Build(RoomEntries, Weights);
+	OutDeadEndSampler.Build(DeadEndEntries, Weights);
+}
+
+void FItemSpawnPlanner::Plan(const FMazeGrid& Maze, TConstArrayView<int32> Cells, const int NumItems, FRandomStream& RandStream, TArray<FItemPlacement>& OutPlan) const
+{
+	OutPlan.Reset();
+	TArray<int32> FreeCells(Cells.GetData(), Cells.Num());
+	TBitArray<> Placed(false, Weights.Num());
+	// copies so unique entries can be dropped without touching the compiled ones.
+	FSpawnAliasSampler PlanRoomSampler = RoomSampler;
+	FSpawnAliasSampler PlanDeadEndSampler = DeadEndSampler;
+	bool bSamplersStale = false;
+	auto AddPlacement = [&](const int32 Entry, const int32 Cell)
+	{
+		FItemPlacement& Placement = OutPlan.AddDefaulted_GetRef();
+		Placement.EntryIndex = Entry;
+		Placement.Cell = Cell;
+		Placement.Yaw = RandStream.FRandRange(0.f, 360.f);
+		if (Unique[Entry] && !Placed[Entry])
+		{
+			bSamplersStale = true;
+		}
+		Placed[Entry] = true;
+	};
+
+	// required ones get first pick of the cells, whatever the item count says.
+	for (const int32 Entry : Required)
+	{
+		int FoundAt = INDEX_NONE;
+		for (int i = FreeCells.Num() - 1; i >= 0; --i)
+		{
+			if (Maze.IsRoom(FreeCells[i]) || DeadEndAllowed[Entry])
+			{
+				FoundAt = i;
+				break;
+			}
+		}
+		if (FoundAt == INDEX_NONE)
+		{
+			UE_LOG(LogTemp, Warning, TEXT("ItemSpawnPlanner: no free cell for required spawn table entry %d"), Entry);
+			continue;
+		}
+		const int32 Cell = FreeCells[FoundAt];
+		FreeCells.RemoveAt(FoundAt, 1, false);
+		AddPlacement(Entry, Cell);
+	}
+
+	while (OutPlan.Num() < NumItems && FreeCells.Num() > 0)
+	{
+		if (bSamplersStale)
+		{
+			BuildSamplers(TBitArray<>::BitwiseAND(Placed, Unique, EBitwiseOperatorFlags::MinSize), PlanRoomSampler, PlanDeadEndSampler);
+			bSamplersStale = false;
+		}
+		if (PlanRoomSampler.IsEmpty() && PlanDeadEndSampler.IsEmpty())
+		{
+			break;
+		}
+		const int32 Cell = FreeCells.Pop(false);
+		const FSpawnAliasSampler& Sampler = Maze.IsRoom(Cell) ? PlanRoomSampler : PlanDeadEndSampler;
+		// nothing can go in this kind of cell, leave it for the monsters.
+		if (!Sampler.IsEmpty())
+		{
+			AddPlacement(Sampler.Sample(RandStream), Cell);
+		}
+	}
+}
@@ -0,0 +1,66 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "MazeGrid.h"
+#include "SpawnTableEntry.h"
+
+// walker's alias table over spawn table entries, weighted by SpawnChance. one uniform pick per sample.
+struct ABYSSTUNNELS_API FSpawnAliasSampler
+{
+	// Weights is indexed by spawn table entry, only Entries are sampled. entries with no weight are left out.
+	void Build(const TArray<int32>& InEntries, const TArray<float>& Weights);
+
+	FORCEINLINE bool IsEmpty() const { return Entries.Num() == 0; }
+
+	// returns the spawn table index.
+	FORCEINLINE int32 Sample(FRandomStream& RandStream) const
+	{
+		const int Column = RandStream.RandRange(0, Entries.Num() - 1);
+		return RandStream.FRand() < Probability[Column] ? Entries[Column] : Entries[Alias[Column]];
+	}
+
+private:
+	TArray<int32> Entries;
+	TArray<float> Probability;
+	// column to fall back to when the roll is over Probability.
+	TArray<int32> Alias;
+};
+
+struct FItemPlacement
+{
+	// into the spawn table the planner was compiled from.
+	int32 EntryIndex = INDEX_NONE;
+	int32 Cell = INDEX_NONE;
+	float Yaw = 0.f;
+};
+
+/**
+ * Decides every item placement of a level before anything is spawned.
+ * Compile() keeps the entries that can show up on the level and builds one sampler for room cells and one for dead ends
+ * (only bCanSpawnInDeadEnds entries). Plan() places every bLevelRequired entry first, then fills the remaining item
+ * count from the sampler matching each cell, dropping bLevelUnique entries from the samplers once they are placed.
+ */
+class ABYSSTUNNELS_API FItemSpawnPlanner
+{
+public:
+	void Compile(const TArray<FSpawnTableEntry>& SpawnTable, const int Level);
+
+	// Cells are taken from the back, like the board's SpawnTopIndex. all randomness comes from RandStream.
+	void Plan(const FMazeGrid& Maze, TConstArrayView<int32> Cells, const int NumItems, FRandomStream& RandStream, TArray<FItemPlacement>& OutPlan) const;
+
+	FORCEINLINE int GetNumEligible() const { return Eligible.Num(); }
+
+private:
+	void BuildSamplers(const TBitArray<>& Excluded, FSpawnAliasSampler& OutRoomSampler, FSpawnAliasSampler& OutDeadEndSampler) const;
+
+	// spawn table indices that can spawn on the compiled level.
+	TArray<int32> Eligible;
+	TArray<int32> Required;
+	TBitArray<> Unique;
+	TBitArray<> DeadEndAllowed;
+	TArray<float> Weights;
+	FSpawnAliasSampler RoomSampler;
+	FSpawnAliasSampler DeadEndSampler;
+};
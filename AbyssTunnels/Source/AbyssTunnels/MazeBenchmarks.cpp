@@ -0,0 +1,800 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+// console commands for timing the maze generation pieces outside of a running level.
+// usage from the console (or -ExecCmds=) e.g. "Abyss.Bench.Carve 1001 2001 4001"
+
+#include "MazeCore.h"
+#include "MazeLayoutBuilder.h"
+#include "MazeDistanceField.h"
+#include "MazeFlowField.h"
+#include "MazeLineOfSight.h"
+#include "MazeVisibilitySet.h"
+#include "ItemSpawnPlanner.h"
+#include "BoardGenerator.h"
+#include "AbyssTunnelsGameMode.h"
+#include "InstancedMeshActor.h"
+#include "Serialization/BitReader.h"
+#include "Serialization/BitWriter.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformTime.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "EngineUtils.h"
+#include "NavigationSystem.h"
+#include "NavigationPath.h"
+
+static TArray<int> ParseBenchDims(const TArray<FString>& Args, const TArray<int>& Defaults)
+{
+	TArray<int> Dims;
+	for (const FString& Arg : Args)
+	{
+		const int Dim = FCString::Atoi(*Arg);
+		if (Dim > 3)
+		{
+			// the carver walks in steps of two so keep dims odd like GetMazeDim does.
+			Dims.Add(Dim % 2 == 0 ? Dim + 1 : Dim);
+		}
+	}
+	return Dims.Num() > 0 ? Dims : Defaults;
+}
+
+static FAutoConsoleCommand BenchCarveCommand(
+	TEXT("Abyss.Bench.Carve"),
+	TEXT("Times the maze carver for each maze dim given (defaults to 501 1001 2001 4001)."),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+	{
+		const TArray<int> Dims = ParseBenchDims(Args, { 501, 1001, 2001, 4001 });
+		for (const int Dim : Dims)
+		{
+			FMazeGrid Maze;
+			Maze.Init(Dim);
+			FRandomStream RandStream(12345);
+			const double StartTime = FPlatformTime::Seconds();
+			FMazeCore::CarveMaze(Maze, Dim, RandStream, 0, 0);
+			const double ElapsedMs = (FPlatformTime::Seconds() - StartTime) * 1000.0;
+			const int SpawnCells = Maze.CountSet(EMazePlane::Spawn);
+			UE_LOG(LogTemp, Display, TEXT("Carve %dx%d: %.2f ms (%.1f ns/cell), %d dead ends"),
+				Dim, Dim, ElapsedMs, ElapsedMs * 1000000.0 / (Dim * Dim), SpawnCells);
+		}
+	}));
+
+// the cell layout the board used before FMazeGrid. only kept around to compare against.
+struct FLegacyMapUnit
+{
+	bool bIsWall = true;
+	bool bIsRoom = false;
+	bool bIsSpawn = false;
+	bool bIsDoor = false;
+	float DoorRotation = 0.0f;
+};
+
+static FAutoConsoleCommand BenchGridCommand(
+	TEXT("Abyss.Bench.Grid"),
+	TEXT("Compares memory and full grid scan time of FMazeGrid against the old per cell struct array (defaults to 131 531 1001 2001)."),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+	{
+		const TArray<int> Dims = ParseBenchDims(Args, { 131, 531, 1001, 2001 });
+		for (const int Dim : Dims)
+		{
+			FMazeGrid Grid;
+			Grid.Init(Dim);
+			FRandomStream RandStream(12345);
+			FMazeCore::CarveMaze(Grid, Dim, RandStream, 0, 0);
+			TArray<FLegacyMapUnit> Legacy;
+			Legacy.SetNum(Grid.Num());
+			for (int i = 0; i < Grid.Num(); ++i)
+			{
+				Legacy[i].bIsWall = Grid.IsWall(i);
+				Legacy[i].bIsSpawn = Grid.IsSpawn(i);
+			}
+
+			// the two scans every level build does: count/emit the walls and collect the spawn cells.
+			TArray<int32> SpawnIndices;
+			SpawnIndices.Reserve(Grid.Num() / 4);
+			double StartTime = FPlatformTime::Seconds();
+			int LegacyWalls = 0;
+			for (int i = 0; i < Legacy.Num(); ++i)
+			{
+				LegacyWalls += Legacy[i].bIsWall ? 1 : 0;
+				if (Legacy[i].bIsSpawn)
+				{
+					SpawnIndices.Add(i);
+				}
+			}
+			const double LegacyMs = (FPlatformTime::Seconds() - StartTime) * 1000.0;
+
+			SpawnIndices.Reset();
+			StartTime = FPlatformTime::Seconds();
+			const int GridWalls = Grid.CountSet(EMazePlane::Wall);
+			Grid.ForEachSet(EMazePlane::Spawn, [&SpawnIndices](const int Index)
+			{
+				SpawnIndices.Add(Index);
+			});
+			const double GridMs = (FPlatformTime::Seconds() - StartTime) * 1000.0;
+
+			UE_LOG(LogTemp, Display, TEXT("Grid %dx%d: legacy %llu bytes %.3f ms, bitplanes %llu bytes %.3f ms (%d/%d walls)"),
+				Dim, Dim, (uint64)Legacy.GetAllocatedSize(), LegacyMs, (uint64)Grid.GetAllocatedSize(), GridMs, LegacyWalls, GridWalls);
+		}
+	}));
+
+// unit cube bounds pushed through every instance transform. roughly what a component does when its instances change.
+static FBox ComputeInstanceBounds(const TArray<FTransform>& Transforms)
+{
+	const FBox UnitBox(FVector(-50.f), FVector(50.f));
+	FBox Bounds(ForceInit);
+	for (const FTransform& Transform : Transforms)
+	{
+		Bounds += UnitBox.TransformBy(Transform);
+	}
+	return Bounds;
+}
+
+static FAutoConsoleCommand BenchWallChunksCommand(
+	TEXT("Abyss.Bench.WallChunks"),
+	TEXT("Builds the layout for a level (default 300) with several wall chunk sizes and reports instances per component and bounds update cost."),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+	{
+		FMazeBuildParams Params;
+		Params.LevelData.SetData(Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 300, 12345, false);
+		Params.NumWallVariants = 4;
+		for (const int ChunkSize : { 0, 8, 16, 32 })
+		{
+			Params.WallChunkSize = ChunkSize;
+			FMazeLayout Layout;
+			FMazeLayoutBuilder::Build(Params, Layout);
+			int Components = 0;
+			int Instances = 0;
+			int LargestBucket = 0;
+			for (int Bucket = 0; Bucket < Layout.WallTransforms.Num(); ++Bucket)
+			{
+				const int Num = Layout.WallTransforms[Bucket].Num();
+				Components += Num > 0 ? 1 : 0;
+				Instances += Num;
+				if (Num > Layout.WallTransforms[LargestBucket].Num())
+				{
+					LargestBucket = Bucket;
+				}
+			}
+			// full rebuild of every component vs touching a single instance (only its own component needs new bounds).
+			double StartTime = FPlatformTime::Seconds();
+			for (const TArray<FTransform>& Transforms : Layout.WallTransforms)
+			{
+				ComputeInstanceBounds(Transforms);
+			}
+			const double AllBoundsMs = (FPlatformTime::Seconds() - StartTime) * 1000.0;
+			StartTime = FPlatformTime::Seconds();
+			ComputeInstanceBounds(Layout.WallTransforms[LargestBucket]);
+			const double LocalBoundsMs = (FPlatformTime::Seconds() - StartTime) * 1000.0;
+			UE_LOG(LogTemp, Display, TEXT("Level %d chunk size %d: %d instances in %d components (max %d per component), all bounds %.3f ms, single update %.3f ms"),
+				Params.LevelData.Level, ChunkSize, Instances, Components, Layout.WallTransforms[LargestBucket].Num(), AllBoundsMs, LocalBoundsMs);
+		}
+	}));
+
+// what the original BuildNewLevel produced for these levels and seeds: the grid after rooms and carve, the stream
+// right after the carve and the stream after GenerateMap picked one of four variants per wall cell. the room corner
+// draws are taken y first like msvc built it. anything touching generation has to keep these.
+struct FMazeGolden
+{
+	int Level;
+	int32 Seed;
+	uint32 GridHash;
+	int32 CarveSeed;
+	int32 FinalSeed;
+};
+
+static const FMazeGolden MazeGoldens[] =
+{
+	{ 1, 1, 0x6A403E96u, -1588876323, -1288344382 },
+	{ 1, 2, 0xEB214109u, 1719583135, 452081973 },
+	{ 1, 3, 0x022C4E19u, 138764755, 1495208497 },
+	{ 1, 4, 0xE1CB693Fu, 171713426, 1829987942 },
+	{ 1, 5, 0xF1F6E60Bu, -1453505135, 26777585 },
+	{ 100, 1, 0x75CC69BDu, -531631595, 2075587965 },
+	{ 100, 2, 0x267C6909u, -646125399, -1457009263 },
+	{ 100, 3, 0xE072F257u, -1147348620, -1083529890 },
+	{ 100, 4, 0x14B5BFDEu, -366608150, -1108344335 },
+	{ 100, 5, 0x5B749D99u, -128591329, 170306547 },
+	{ 300, 1, 0x3BA1642Du, 1360558517, -1746886067 },
+	{ 300, 2, 0x9D282BA9u, -1477224887, -1499931295 },
+	{ 300, 3, 0x04DC81DFu, 2026952084, -925029394 },
+	{ 300, 4, 0x557293AAu, -496063990, 1302510017 },
+	{ 300, 5, 0xAEC4AC01u, -862718785, 1737557827 },
+	{ 500, 1, 0x1F35F2A5u, 1070884981, -1556917123 },
+	{ 500, 2, 0x078584BDu, 1076205833, -1043383151 },
+	{ 500, 3, 0x8E158FD3u, -147262636, 482310238 },
+	{ 500, 4, 0xD65B7B61u, 302144970, -1670767570 },
+	{ 500, 5, 0x5A727325u, -40120961, -1594916109 },
+};
+
+// fnv-1a over one byte of flags per cell, in index order.
+static uint32 HashMazeGrid(const FMazeGrid& Maze)
+{
+	uint32 Hash = 0x811C9DC5u;
+	for (int Index = 0; Index < Maze.Num(); ++Index)
+	{
+		const uint8 Flags = (Maze.IsWall(Index) ? 1 : 0) | (Maze.IsRoom(Index) ? 2 : 0) | (Maze.IsSpawn(Index) ? 4 : 0)
+			| (Maze.IsDoor(Index) ? 8 : 0) | (Maze.GetDoorRotation(Index) != 0.f ? 16 : 0);
+		Hash = (Hash ^ Flags) * 0x01000193u;
+	}
+	return Hash;
+}
+
+static const FMazeGolden* FindMazeGolden(const int Level, const int32 Seed)
+{
+	for (const FMazeGolden& Golden : MazeGoldens)
+	{
+		if (Golden.Level == Level && Golden.Seed == Seed)
+		{
+			return &Golden;
+		}
+	}
+	return nullptr;
+}
+
+static FAutoConsoleCommand BenchMazeCoreCommand(
+	TEXT("Abyss.Bench.MazeCore"),
+	TEXT("Times FMazeCore::Generate (rooms + carve + spawn/door collection) for levels 1 100 300 500 over a number of seeds (default 20), checks the seeds with a golden value against what the original BuildNewLevel generated, and that the spawn cells collected during generation match a full grid scan."),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+	{
+		const int NumSeeds = Args.Num() > 0 ? FMath::Max(1, FCString::Atoi(*Args[0])) : 20;
+		for (const int Level : { 1, 100, 300, 500 })
+		{
+			FMapLevelData LevelData;
+			LevelData.SetData(Level, 0, false);
+			FMazeCoreParams Params = FMazeLayoutBuilder::MakeCoreParams(LevelData);
+			double TotalMs = 0.0;
+			int GoldenChecks = 0;
+			int GoldenMismatches = 0;
+			int SpawnIndexMismatches = 0;
+			int SpawnCells = 0;
+			for (int Seed = 1; Seed <= NumSeeds; ++Seed)
+			{
+				Params.Seed = Seed;
+				FMazeCoreResult Result;
+				const double StartTime = FPlatformTime::Seconds();
+				FMazeCore::Generate(Params, Result);
+				TotalMs += (FPlatformTime::Seconds() - StartTime) * 1000.0;
+				SpawnCells += Result.SpawnCells.Num();
+
+				if (const FMazeGolden* Golden = FindMazeGolden(Level, Seed))
+				{
+					// the full layout build too, for the stream after the wall variant picks.
+					FMazeBuildParams BuildParams;
+					BuildParams.LevelData.SetData(Level, Seed, false);
+					BuildParams.NumWallVariants = 4;
+					FMazeLayout Layout;
+					FMazeLayoutBuilder::Build(BuildParams, Layout);
+					const uint32 GridHash = HashMazeGrid(Result.Maze);
+					GoldenChecks++;
+					if (GridHash != Golden->GridHash || Result.RandStream.GetCurrentSeed() != Golden->CarveSeed || Layout.RandStream.GetCurrentSeed() != Golden->FinalSeed)
+					{
+						GoldenMismatches++;
+						UE_LOG(LogTemp, Error, TEXT("MazeCore level %d seed %d differs from the original generation: grid hash 0x%08X (expected 0x%08X), carve seed %d (expected %d), final seed %d (expected %d)"),
+							Level, Seed, GridHash, Golden->GridHash, Result.RandStream.GetCurrentSeed(), Golden->CarveSeed, Layout.RandStream.GetCurrentSeed(), Golden->FinalSeed);
+					}
+				}
+
+				FMazeGrid IndexedMaze;
+				FRandomStream IndexedStream;
+				TArray<int32> IndexedSpawnCells;
+				FMazeCore::Generate(Params, IndexedMaze, IndexedStream, nullptr, &IndexedSpawnCells);
+				IndexedSpawnCells.Sort();
+				SpawnIndexMismatches += IndexedSpawnCells == Result.SpawnCells ? 0 : 1;
+			}
+			UE_LOG(LogTemp, Display, TEXT("MazeCore level %d (%dx%d): %.3f ms avg over %d seeds, %.1f spawn cells avg, %d of %d golden seeds differ, %d spawn index mismatches"),
+				Level, Params.MazeDim, Params.MazeDim, TotalMs / NumSeeds, NumSeeds, float(SpawnCells) / NumSeeds, GoldenMismatches, GoldenChecks, SpawnIndexMismatches);
+		}
+	}));
+
+// a made up table with a bit of everything: weights all over the place, a dead end only flavour, uniques and requireds.
+static TArray<FSpawnTableEntry> MakeBenchSpawnTable(const int NumEntries)
+{
+	TArray<FSpawnTableEntry> SpawnTable;
+	FRandomStream RandStream(777);
+	for (int i = 0; i < NumEntries; ++i)
+	{
+		FSpawnTableEntry& Entry = SpawnTable.AddDefaulted_GetRef();
+		Entry.SpawnableObjectClass = TSoftClassPtr<ASpawnableObject>(ASpawnableObject::StaticClass());
+		Entry.SpawnChance = RandStream.FRandRange(0.01f, 1.f);
+		Entry.MinimumLevel = 1;
+		Entry.MaximumLevel = 500;
+		Entry.bCanSpawnInDeadEnds = i % 3 == 0;
+		Entry.bLevelUnique = i % 5 == 0;
+		Entry.bLevelRequired = i % 7 == 0;
+	}
+	return SpawnTable;
+}
+
+static FAutoConsoleCommand BenchItemSpawnPlanCommand(
+	TEXT("Abyss.Bench.ItemSpawnPlan"),
+	TEXT("Compiles a made up spawn table of NumEntries (default 64) and plans a level's items for levels 1 100 300 500. Reports the time and any required entry missing or unique entry placed twice."),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+	{
+		const int NumEntries = Args.Num() > 0 ? FMath::Max(1, FCString::Atoi(*Args[0])) : 64;
+		const TArray<FSpawnTableEntry> SpawnTable = MakeBenchSpawnTable(NumEntries);
+		for (const int Level : { 1, 100, 300, 500 })
+		{
+			FMapLevelData LevelData;
+			LevelData.SetData(Level, 0, false);
+			FMazeCoreResult Result;
+			FMazeCore::Generate(FMazeLayoutBuilder::MakeCoreParams(LevelData), Result);
+			FRandomStream RandStream(Level);
+			FMazeCore::ShuffleCells(Result.SpawnCells, [&RandStream](const int Min, const int Max)
+			{
+				return RandStream.RandRange(Min, Max);
+			});
+
+			const double StartTime = FPlatformTime::Seconds();
+			FItemSpawnPlanner Planner;
+			Planner.Compile(SpawnTable, Level);
+			TArray<FItemPlacement> Plan;
+			Planner.Plan(Result.Maze, Result.SpawnCells, LevelData.NumberOfItems(), RandStream, Plan);
+			const double ElapsedMs = (FPlatformTime::Seconds() - StartTime) * 1000.0;
+
+			TArray<int> TimesPlaced;
+			TimesPlaced.SetNumZeroed(SpawnTable.Num());
+			for (const FItemPlacement& Placement : Plan)
+			{
+				TimesPlaced[Placement.EntryIndex]++;
+			}
+			int MissingRequired = 0;
+			int RepeatedUnique = 0;
+			for (int i = 0; i < SpawnTable.Num(); ++i)
+			{
+				MissingRequired += SpawnTable[i].bLevelRequired && TimesPlaced[i] == 0 ? 1 : 0;
+				RepeatedUnique += SpawnTable[i].bLevelUnique && TimesPlaced[i] > 1 ? 1 : 0;
+			}
+			UE_LOG(LogTemp, Display, TEXT("ItemSpawnPlan level %d: %d items in %d spawn cells, %d eligible entries, %.3f ms, %d required missing, %d unique repeated"),
+				Level, Plan.Num(), Result.SpawnCells.Num(), Planner.GetNumEligible(), ElapsedMs, MissingRequired, RepeatedUnique);
+		}
+	}));
+
+static FAutoConsoleCommand BenchDistanceFieldCommand(
+	TEXT("Abyss.Bench.DistanceField"),
+	TEXT("Times one distance field rebuild (what a player stepping into a new cell costs) for levels 1 100 300 500."),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+	{
+		for (const int Level : { 1, 100, 300, 500 })
+		{
+			FMapLevelData LevelData;
+			LevelData.SetData(Level, 12345, false);
+			FMazeCoreResult Result;
+			FMazeCore::Generate(FMazeLayoutBuilder::MakeCoreParams(LevelData), Result);
+			if (Result.SpawnCells.Num() == 0)
+			{
+				continue;
+			}
+			FMazeDistanceField Field;
+			constexpr int NumBuilds = 20;
+			const double StartTime = FPlatformTime::Seconds();
+			for (int i = 0; i < NumBuilds; ++i)
+			{
+				Field.Build(Result.Maze, Result.SpawnCells[i % Result.SpawnCells.Num()]);
+			}
+			const double ElapsedMs = (FPlatformTime::Seconds() - StartTime) * 1000.0 / NumBuilds;
+			int32 Farthest = 0;
+			for (const int32 Distance : Field.GetDistances())
+			{
+				Farthest = Distance != FMazeDistanceField::Unreachable ? FMath::Max(Farthest, Distance) : Farthest;
+			}
+			UE_LOG(LogTemp, Display, TEXT("DistanceField level %d (%dx%d): %.3f ms per rebuild, %llu bytes, farthest cell %d steps"),
+				Level, Result.Maze.GetDim(), Result.Maze.GetDim(), ElapsedMs, (uint64)Field.GetAllocatedSize(), Farthest);
+		}
+	}));
+
+// flow field vs navmesh for a crowd of monsters chasing one target. with a board in the world it uses that level
+// and its navmesh, otherwise only the flow field half runs on a freshly generated maze.
+static FAutoConsoleCommandWithWorldAndArgs BenchFlowFieldCommand(
+	TEXT("Abyss.Bench.FlowField"),
+	TEXT("Compares steering NumMonsters (default 20) monsters with the shared flow field against one navmesh path query each. Second arg is the level to generate when no board is around (default 100)."),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		const int NumMonsters = Args.Num() > 0 ? FMath::Max(1, FCString::Atoi(*Args[0])) : 20;
+		const int Level = Args.Num() > 1 ? FMath::Max(1, FCString::Atoi(*Args[1])) : 100;
+		ABoardGenerator* Board = nullptr;
+		if (World)
+		{
+			for (TActorIterator<ABoardGenerator> It(World); It; ++It)
+			{
+				if (It->GetMaze().Num() > 0)
+				{
+					Board = *It;
+					break;
+				}
+			}
+		}
+		FMazeGrid GeneratedMaze;
+		if (!Board)
+		{
+			FMapLevelData LevelData;
+			LevelData.SetData(Level, 12345, false);
+			FRandomStream GeneratedStream;
+			FMazeCore::Generate(FMazeLayoutBuilder::MakeCoreParams(LevelData), GeneratedMaze, GeneratedStream);
+		}
+		const FMazeGrid& Maze = Board ? Board->GetMaze() : GeneratedMaze;
+
+		TArray<int32> OpenCells;
+		for (int i = 0; i < Maze.Num(); ++i)
+		{
+			if (!Maze.IsWall(i))
+			{
+				OpenCells.Add(i);
+			}
+		}
+		FRandomStream PickStream(54321);
+		const int TargetCell = OpenCells[PickStream.RandRange(0, OpenCells.Num() - 1)];
+		TArray<int32> MonsterCells;
+		for (int i = 0; i < NumMonsters; ++i)
+		{
+			MonsterCells.Add(OpenCells[PickStream.RandRange(0, OpenCells.Num() - 1)]);
+		}
+
+		FMazeFlowField Field;
+		double StartTime = FPlatformTime::Seconds();
+		Field.Build(Maze, TargetCell);
+		const double BuildMs = (FPlatformTime::Seconds() - StartTime) * 1000.0;
+		const int CellsPerFrame = IConsoleManager::Get().FindConsoleVariable(TEXT("Abyss.FlowField.CellsPerFrame"))->GetInt();
+		int Frames = 0;
+		double WorstSliceMs = 0.0;
+		Field.BeginBuild(Maze, TargetCell);
+		while (!Field.IsComplete())
+		{
+			StartTime = FPlatformTime::Seconds();
+			Field.StepBuild(Maze, CellsPerFrame);
+			WorstSliceMs = FMath::Max(WorstSliceMs, (FPlatformTime::Seconds() - StartTime) * 1000.0);
+			Frames++;
+		}
+
+		// one steering lookup per monster, repeated so the timer has something to measure.
+		constexpr int LookupRounds = 1000;
+		int Reached = 0;
+		StartTime = FPlatformTime::Seconds();
+		for (int Round = 0; Round < LookupRounds; ++Round)
+		{
+			for (const int32 Cell : MonsterCells)
+			{
+				Reached += Field.GetNextCell(Cell) != INDEX_NONE ? 1 : 0;
+			}
+		}
+		const double LookupUs = (FPlatformTime::Seconds() - StartTime) * 1000000.0 / LookupRounds;
+		UE_LOG(LogTemp, Display, TEXT("FlowField %dx%d: full build %.3f ms (%llu bytes), time sliced %d frames at %d cells (worst slice %.3f ms), %d monster lookups %.3f us per frame (%d reachable)"),
+			Maze.GetDim(), Maze.GetDim(), BuildMs, (uint64)Field.GetAllocatedSize(), Frames, CellsPerFrame, WorstSliceMs,
+			NumMonsters, LookupUs, Reached / LookupRounds);
+
+		UNavigationSystemV1* NavSys = World ? FNavigationSystem::GetCurrent<UNavigationSystemV1>(World) : nullptr;
+		if (!Board || !NavSys)
+		{
+			UE_LOG(LogTemp, Display, TEXT("FlowField: no board/navigation system in this world, skipping the navmesh comparison."));
+			return;
+		}
+		const int MazeDim = Maze.GetDim();
+		const FVector TargetLocation = Board->ConvertUnitsToLocation(FVector2d(TargetCell % MazeDim, TargetCell / MazeDim));
+		int PathsFound = 0;
+		StartTime = FPlatformTime::Seconds();
+		for (const int32 Cell : MonsterCells)
+		{
+			const FVector MonsterLocation = Board->ConvertUnitsToLocation(FVector2d(Cell % MazeDim, Cell / MazeDim));
+			const UNavigationPath* Path = NavSys->FindPathToLocationSynchronously(World, MonsterLocation, TargetLocation);
+			PathsFound += (Path && Path->IsValid()) ? 1 : 0;
+		}
+		const double NavMs = (FPlatformTime::Seconds() - StartTime) * 1000.0;
+		UE_LOG(LogTemp, Display, TEXT("FlowField: %d navmesh path queries %.3f ms (%d found), flow field build + lookups %.3f ms"),
+			NumMonsters, NavMs, PathsFound, BuildMs + LookupUs / 1000.0);
+	}));
+
+// grid line of sight vs the environment channel trace UpdatePlayerSeeing used to do, between random open cells.
+static FAutoConsoleCommandWithWorldAndArgs BenchLineOfSightCommand(
+	TEXT("Abyss.Bench.LineOfSight"),
+	TEXT("Times NumPairs (default 1000) line of sight checks between random open cells with the grid DDA and, when a board is in play, with physics traces, and counts where they disagree."),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		const int NumPairs = Args.Num() > 0 ? FMath::Max(1, FCString::Atoi(*Args[0])) : 1000;
+		ABoardGenerator* Board = nullptr;
+		if (World)
+		{
+			for (TActorIterator<ABoardGenerator> It(World); It; ++It)
+			{
+				if (It->GetMaze().Num() > 0)
+				{
+					Board = *It;
+					break;
+				}
+			}
+		}
+		FMazeGrid GeneratedMaze;
+		if (!Board)
+		{
+			FMapLevelData LevelData;
+			LevelData.SetData(100, 12345, false);
+			FRandomStream GeneratedStream;
+			FMazeCore::Generate(FMazeLayoutBuilder::MakeCoreParams(LevelData), GeneratedMaze, GeneratedStream);
+		}
+		const FMazeGrid& Maze = Board ? Board->GetMaze() : GeneratedMaze;
+		const int MazeDim = Maze.GetDim();
+		TArray<int32> OpenCells;
+		for (int i = 0; i < Maze.Num(); ++i)
+		{
+			if (!Maze.IsWall(i))
+			{
+				OpenCells.Add(i);
+			}
+		}
+		// mostly short range pairs like a monster looking down a corridor, not the far corners of the maze.
+		FRandomStream PickStream(777);
+		TArray<TPair<int32, int32>> Pairs;
+		while (Pairs.Num() < NumPairs)
+		{
+			const int32 From = OpenCells[PickStream.RandRange(0, OpenCells.Num() - 1)];
+			const int32 To = OpenCells[PickStream.RandRange(0, OpenCells.Num() - 1)];
+			if (FMath::Abs(From % MazeDim - To % MazeDim) <= 12 && FMath::Abs(From / MazeDim - To / MazeDim) <= 12)
+			{
+				Pairs.Add({ From, To });
+			}
+		}
+
+		TArray<EMazeSight> GridResults;
+		GridResults.Reserve(NumPairs);
+		double StartTime = FPlatformTime::Seconds();
+		for (const TPair<int32, int32>& Pair : Pairs)
+		{
+			GridResults.Add(FMazeLineOfSight::Trace(Maze, FVector2D(Pair.Key % MazeDim, Pair.Key / MazeDim), FVector2D(Pair.Value % MazeDim, Pair.Value / MazeDim)));
+		}
+		const double GridMs = (FPlatformTime::Seconds() - StartTime) * 1000.0;
+		int Unknown = 0;
+		for (const EMazeSight Sight : GridResults)
+		{
+			Unknown += Sight == EMazeSight::Unknown ? 1 : 0;
+		}
+		UE_LOG(LogTemp, Display, TEXT("LineOfSight %dx%d: %d grid checks %.3f ms (%.1f ns each), %d needed the physics fallback"),
+			MazeDim, MazeDim, NumPairs, GridMs, GridMs * 1000000.0 / NumPairs, Unknown);
+		if (!Board)
+		{
+			UE_LOG(LogTemp, Display, TEXT("LineOfSight: no board in this world, skipping the trace comparison."));
+			return;
+		}
+
+		// eye height of the default capsule so the traces don't skim the floor.
+		const FVector EyeOffset(0, 0, 96.f);
+		int Mismatches = 0;
+		StartTime = FPlatformTime::Seconds();
+		for (int i = 0; i < NumPairs; ++i)
+		{
+			const FVector From = Board->ConvertUnitsToLocation(FVector2d(Pairs[i].Key % MazeDim, Pairs[i].Key / MazeDim)) + EyeOffset;
+			const FVector To = Board->ConvertUnitsToLocation(FVector2d(Pairs[i].Value % MazeDim, Pairs[i].Value / MazeDim)) + EyeOffset;
+			FHitResult Hit;
+			const bool bTraceClear = !World->LineTraceSingleByChannel(Hit, From, To, ECC_GameTraceChannel1);
+			if (GridResults[i] != EMazeSight::Unknown && bTraceClear != (GridResults[i] == EMazeSight::Clear))
+			{
+				Mismatches++;
+			}
+		}
+		const double TraceMs = (FPlatformTime::Seconds() - StartTime) * 1000.0;
+		UE_LOG(LogTemp, Display, TEXT("LineOfSight: %d physics traces %.3f ms (%.1f ns each), %d disagreements with the grid"),
+			NumPairs, TraceMs, TraceMs * 1000000.0 / NumPairs, Mismatches);
+	}));
+
+static FAutoConsoleCommand BenchVisibilitySetCommand(
+	TEXT("Abyss.Bench.VisibilitySet"),
+	TEXT("Builds the visibility set for levels 1 100 300 500 with the given radius (default 12) and reports build time, memory and query time against the grid DDA."),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+	{
+		const int Radius = Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 12;
+		for (const int Level : { 1, 100, 300, 500 })
+		{
+			FMapLevelData LevelData;
+			LevelData.SetData(Level, 12345, false);
+			FMazeCoreResult Result;
+			FMazeCore::Generate(FMazeLayoutBuilder::MakeCoreParams(LevelData), Result);
+			const FMazeGrid& Maze = Result.Maze;
+			const int MazeDim = Maze.GetDim();
+
+			FMazeVisibilitySet VisibilitySet;
+			double StartTime = FPlatformTime::Seconds();
+			VisibilitySet.Build(Maze, Radius);
+			const double BuildMs = (FPlatformTime::Seconds() - StartTime) * 1000.0;
+			// an uncompressed window per cell, for comparison.
+			const uint64 DenseBytes = uint64(Maze.Num()) * FMazeVisibilitySet::WordsPerWindow * sizeof(uint64);
+
+			TArray<TPair<int32, int32>> Pairs;
+			FRandomStream PickStream(777);
+			while (Pairs.Num() < 10000)
+			{
+				const int32 From = PickStream.RandRange(0, Maze.Num() - 1);
+				const int32 To = FMazeCore::GetIndex(MazeDim, FMath::Clamp(From % MazeDim + PickStream.RandRange(-8, 8), 0, MazeDim - 1),
+					FMath::Clamp(From / MazeDim + PickStream.RandRange(-8, 8), 0, MazeDim - 1));
+				if (!Maze.IsWall(From) && !Maze.IsWall(To))
+				{
+					Pairs.Add({ From, To });
+				}
+			}
+			int Agree = 0;
+			int Known = 0;
+			StartTime = FPlatformTime::Seconds();
+			for (const TPair<int32, int32>& Pair : Pairs)
+			{
+				const EMazeSight Sight = VisibilitySet.Query(Pair.Key, Pair.Value);
+				Known += Sight != EMazeSight::Unknown ? 1 : 0;
+			}
+			const double QueryMs = (FPlatformTime::Seconds() - StartTime) * 1000.0;
+			StartTime = FPlatformTime::Seconds();
+			for (const TPair<int32, int32>& Pair : Pairs)
+			{
+				const EMazeSight Sight = FMazeLineOfSight::Trace(Maze, FVector2D(Pair.Key % MazeDim, Pair.Key / MazeDim), FVector2D(Pair.Value % MazeDim, Pair.Value / MazeDim));
+				const EMazeSight Precomputed = VisibilitySet.Query(Pair.Key, Pair.Value);
+				Agree += (Precomputed == EMazeSight::Unknown || Precomputed == Sight) ? 1 : 0;
+			}
+			const double DdaMs = (FPlatformTime::Seconds() - StartTime) * 1000.0 - QueryMs;
+			UE_LOG(LogTemp, Display, TEXT("VisibilitySet level %d (%dx%d) radius %d: built in %.1f ms, %llu bytes (%llu dense), 10000 queries %.3f ms vs dda %.3f ms, %d answered, %d agree"),
+				Level, MazeDim, MazeDim, VisibilitySet.GetRadius(), BuildMs, (uint64)VisibilitySet.GetAllocatedSize(), DenseBytes, QueryMs, DdaMs, Known, Agree);
+		}
+	}));
+
+// bytes per instance for FInstanceEntryData before and after the quantized NetSerialize. "before" is what the
+// reflected path sent per item: the id as an int and each FTransform member through its own NetSerialize.
+static FAutoConsoleCommand BenchInstanceNetSerializeCommand(
+	TEXT("Abyss.Bench.InstanceNetSerialize"),
+	TEXT("Serializes Count (default 1000) floor placed and free instances the old way and with each Abyss.InstanceNetPrecision and reports bits per instance and round trip error."),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+	{
+		const int Count = Args.Num() > 0 ? FMath::Max(1, FCString::Atoi(*Args[0])) : 1000;
+		FRandomStream RandStream(4242);
+		TArray<FInstanceEntryData> FloorInstances;
+		TArray<FInstanceEntryData> FreeInstances;
+		for (int i = 0; i < Count; ++i)
+		{
+			// like decals/markers on the maze floor: yaw only, uniform scale.
+			FInstanceEntryData& Floor = FloorInstances.AddDefaulted_GetRef();
+			Floor.Index = i;
+			Floor.InstanceTransform = FTransform(FRotator(0, RandStream.FRandRange(-180, 180), 0),
+				FVector(RandStream.FRandRange(-30000, 30000), RandStream.FRandRange(-30000, 30000), 0), FVector(RandStream.FRandRange(1, 10)));
+			FInstanceEntryData& Free = FreeInstances.AddDefaulted_GetRef();
+			Free.Index = i;
+			Free.InstanceTransform = FTransform(FRotator(RandStream.FRandRange(-90, 90), RandStream.FRandRange(-180, 180), RandStream.FRandRange(-180, 180)),
+				RandStream.GetUnitVector() * RandStream.FRandRange(0, 30000), FVector(RandStream.FRandRange(1, 10), RandStream.FRandRange(1, 10), RandStream.FRandRange(1, 10)));
+		}
+
+		auto MeasureLegacy = [](TArray<FInstanceEntryData>& Instances)
+		{
+			FBitWriter Writer(0, true);
+			bool bSuccess = true;
+			for (FInstanceEntryData& Instance : Instances)
+			{
+				Writer << Instance.Index;
+				FQuat Rotation = Instance.InstanceTransform.GetRotation();
+				FVector Translation = Instance.InstanceTransform.GetTranslation();
+				FVector Scale = Instance.InstanceTransform.GetScale3D();
+				Rotation.NetSerialize(Writer, nullptr, bSuccess);
+				Translation.NetSerialize(Writer, nullptr, bSuccess);
+				Scale.NetSerialize(Writer, nullptr, bSuccess);
+			}
+			return double(Writer.GetNumBits()) / Instances.Num();
+		};
+		auto MeasureQuantized = [](TArray<FInstanceEntryData>& Instances, double& OutMaxLocationError, double& OutMaxAngleError)
+		{
+			FBitWriter Writer(0, true);
+			bool bSuccess = true;
+			for (FInstanceEntryData& Instance : Instances)
+			{
+				Instance.NetSerialize(Writer, nullptr, bSuccess);
+			}
+			FBitReader Reader(Writer.GetData(), Writer.GetNumBits());
+			OutMaxLocationError = 0.0;
+			OutMaxAngleError = 0.0;
+			for (const FInstanceEntryData& Instance : Instances)
+			{
+				FInstanceEntryData Received;
+				Received.NetSerialize(Reader, nullptr, bSuccess);
+				OutMaxLocationError = FMath::Max(OutMaxLocationError, FVector::Dist(Received.InstanceTransform.GetLocation(), Instance.InstanceTransform.GetLocation()));
+				OutMaxAngleError = FMath::Max(OutMaxAngleError, FMath::RadiansToDegrees(Received.InstanceTransform.GetRotation().AngularDistance(Instance.InstanceTransform.GetRotation())));
+			}
+			return double(Writer.GetNumBits()) / Instances.Num();
+		};
+
+		IConsoleVariable* PrecisionVar = IConsoleManager::Get().FindConsoleVariable(TEXT("Abyss.InstanceNetPrecision"));
+		const int OldPrecision = PrecisionVar->GetInt();
+		UE_LOG(LogTemp, Display, TEXT("InstanceNetSerialize before: floor %.1f bytes, free %.1f bytes per instance"),
+			MeasureLegacy(FloorInstances) / 8.0, MeasureLegacy(FreeInstances) / 8.0);
+		for (int Precision = 0; Precision <= 2; ++Precision)
+		{
+			PrecisionVar->Set(Precision, ECVF_SetByConsole);
+			double FloorLocationError, FloorAngleError, FreeLocationError, FreeAngleError;
+			const double FloorBits = MeasureQuantized(FloorInstances, FloorLocationError, FloorAngleError);
+			const double FreeBits = MeasureQuantized(FreeInstances, FreeLocationError, FreeAngleError);
+			UE_LOG(LogTemp, Display, TEXT("InstanceNetSerialize precision %d: floor %.1f bytes (max error %.3f cm, %.3f deg), free %.1f bytes (max error %.3f cm, %.3f deg) per instance"),
+				Precision, FloorBits / 8.0, FloorLocationError, FloorAngleError, FreeBits / 8.0, FreeLocationError, FreeAngleError);
+		}
+		PrecisionVar->Set(OldPrecision, ECVF_SetByConsole);
+	}));
+
+// full BuildNewLevel on a real board, so instancing and actor spawns are included. meant to be run in a
+// -nullrhi game e.g. "-ExecCmds=Abyss.Bench.LevelBuild 500 10". results land in Saved/Profiling/.
+// the board lives in a throwaway world of its own: no game mode or game state there, so it never becomes the
+// current board, doesn't touch the live actor pool or decals, and the world subsystems it registers with are
+// the bench world's. that world is never ticked so no timers, monsters or replication either. without the
+// game mode's pool the items and doors are plain spawns.
+static FAutoConsoleCommandWithWorldAndArgs BenchLevelBuildCommand(
+	TEXT("Abyss.Bench.LevelBuild"),
+	TEXT("Runs BuildNewLevel for levels 1..MaxLevel (default 500) over a number of seeds (default 5), every LevelStep levels (default 1), and writes per phase timings, memory and counts to CSV and JSON."),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		if (!World)
+		{
+			return;
+		}
+		const int MaxLevel = Args.Num() > 0 ? FMath::Max(1, FCString::Atoi(*Args[0])) : 500;
+		const int NumSeeds = Args.Num() > 1 ? FMath::Max(1, FCString::Atoi(*Args[1])) : 5;
+		const int LevelStep = Args.Num() > 2 ? FMath::Max(1, FCString::Atoi(*Args[2])) : 1;
+
+		// use the game's board blueprint when there is one so the real meshes and spawn data are part of the run.
+		TSubclassOf<ABoardGenerator> BoardClass = ABoardGenerator::StaticClass();
+		if (const AAbyssTunnelsGameMode* GameMode = World->GetAuthGameMode<AAbyssTunnelsGameMode>())
+		{
+			if (GameMode->BoardGenClass)
+			{
+				BoardClass = GameMode->BoardGenClass;
+			}
+		}
+		UWorld* BenchWorld = UWorld::CreateWorld(EWorldType::Game, false, TEXT("AbyssBenchWorld"));
+		if (!BenchWorld)
+		{
+			UE_LOG(LogTemp, Error, TEXT("Abyss.Bench.LevelBuild: could not create the bench world"));
+			return;
+		}
+		FActorSpawnParameters SpawnParams;
+		SpawnParams.bDeferConstruction = true;
+		ABoardGenerator* Board = BenchWorld->SpawnActor<ABoardGenerator>(BoardClass, FTransform::Identity, SpawnParams);
+		if (!Board)
+		{
+			UE_LOG(LogTemp, Error, TEXT("Abyss.Bench.LevelBuild: could not spawn %s"), *BoardClass->GetName());
+			BenchWorld->DestroyWorld(false);
+			return;
+		}
+		// synchronous builds so every phase is measured inside the loop, and no background work for levels we never play.
+		Board->bGenerateLevelAsync = false;
+		Board->bPrebuildNextLevel = false;
+		Board->FinishSpawning(FTransform::Identity);
+
+		TArray<FLevelBuildStats> Results;
+		Results.Reserve((MaxLevel / LevelStep + 1) * NumSeeds);
+		const double BenchStartTime = FPlatformTime::Seconds();
+		for (int Level = 1; Level <= MaxLevel; Level += LevelStep)
+		{
+			for (int Seed = 1; Seed <= NumSeeds; ++Seed)
+			{
+				Board->CurrentMapLevelData.SetData(Level, Seed, false);
+				Board->BuildNewLevel();
+				Results.Add(Board->GetLastBuildStats());
+			}
+		}
+		Board->Destroy();
+		// takes whatever the levels spawned down with it.
+		BenchWorld->DestroyWorld(false);
+
+		FString Csv = TEXT("Level,Seed,MazeDim,TerrainUnitSizeMultiplier,RoomsMs,CarveMs,TransformsMs,InstancingMs,DoorSpawnMs,ItemSpawnMs,WallInstances,WallComponents,SpawnedActors,RoomsMemoryDelta,CarveMemoryDelta,TransformsMemoryDelta,InstancingMemoryDelta,DoorSpawnMemoryDelta,ItemSpawnMemoryDelta\n");
+		FString Json = TEXT("[\n");
+		for (int i = 0; i < Results.Num(); ++i)
+		{
+			const FLevelBuildStats& Stats = Results[i];
+			FMapLevelData LevelData;
+			LevelData.SetData(Stats.Level, Stats.Seed, false);
+			const float Multiplier = LevelData.GetTerrainUnitSizeMultiplier();
+			Csv += FString::Printf(TEXT("%d,%d,%d,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%d,%d,%d,%lld,%lld,%lld,%lld,%lld,%lld\n"),
+				Stats.Level, Stats.Seed, Stats.MazeDim, Multiplier, Stats.RoomsMs, Stats.CarveMs, Stats.TransformsMs,
+				Stats.InstancingMs, Stats.DoorSpawnMs, Stats.ItemSpawnMs, Stats.WallInstances, Stats.WallComponents, Stats.SpawnedActors,
+				Stats.RoomsMemoryDelta, Stats.CarveMemoryDelta, Stats.TransformsMemoryDelta, Stats.InstancingMemoryDelta,
+				Stats.DoorSpawnMemoryDelta, Stats.ItemSpawnMemoryDelta);
+			Json += FString::Printf(TEXT("\t{\"level\": %d, \"seed\": %d, \"mazeDim\": %d, \"terrainUnitSizeMultiplier\": %.3f, \"roomsMs\": %.3f, \"carveMs\": %.3f, \"transformsMs\": %.3f, \"instancingMs\": %.3f, \"doorSpawnMs\": %.3f, \"itemSpawnMs\": %.3f, \"wallInstances\": %d, \"wallComponents\": %d, \"spawnedActors\": %d, \"roomsMemoryDelta\": %lld, \"carveMemoryDelta\": %lld, \"transformsMemoryDelta\": %lld, \"instancingMemoryDelta\": %lld, \"doorSpawnMemoryDelta\": %lld, \"itemSpawnMemoryDelta\": %lld}%s\n"),
+				Stats.Level, Stats.Seed, Stats.MazeDim, Multiplier, Stats.RoomsMs, Stats.CarveMs, Stats.TransformsMs,
+				Stats.InstancingMs, Stats.DoorSpawnMs, Stats.ItemSpawnMs, Stats.WallInstances, Stats.WallComponents, Stats.SpawnedActors,
+				Stats.RoomsMemoryDelta, Stats.CarveMemoryDelta, Stats.TransformsMemoryDelta, Stats.InstancingMemoryDelta,
+				Stats.DoorSpawnMemoryDelta, Stats.ItemSpawnMemoryDelta, i + 1 < Results.Num() ? TEXT(",") : TEXT(""));
+		}
+		Json += TEXT("]\n");
+
+		const FString BaseName = FPaths::ProfilingDir() / FString::Printf(TEXT("LevelBuild-%s"), *FDateTime::Now().ToString());
+		FFileHelper::SaveStringToFile(Csv, *(BaseName + TEXT(".csv")));
+		FFileHelper::SaveStringToFile(Json, *(BaseName + TEXT(".json")));
+		// the process high water mark only means anything for the run as a whole.
+		UE_LOG(LogTemp, Display, TEXT("Abyss.Bench.LevelBuild: %d builds in %.1f s, process peak used physical %llu MB, written to %s.csv/.json"),
+			Results.Num(), FPlatformTime::Seconds() - BenchStartTime, uint64(FPlatformMemory::GetStats().PeakUsedPhysical) / (1024 * 1024), *BaseName);
+	}));
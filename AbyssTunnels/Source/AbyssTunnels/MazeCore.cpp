@@ -0,0 +1,226 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MazeCore.h"
+#include "HAL/PlatformMemory.h"
+
+void FMazeCore::Generate(const FMazeCoreParams& Params, FMazeGrid& OutMaze, FRandomStream& OutRandStream, FMazeCoreTimings* OutTimings,
+	TArray<int32>* OutSpawnCells)
+{
+	check(Params.MazeDim > 3);
+	OutMaze.Init(Params.MazeDim);
+	// these things need to stay in sync with the random stream so they are deterministic.
+	OutRandStream = FRandomStream(Params.Seed);
+	const double StartTime = FPlatformTime::Seconds();
+	const int64 StartMemory = OutTimings ? int64(FPlatformMemory::GetStats().UsedPhysical) : 0;
+	if (OutSpawnCells)
+	{
+		OutSpawnCells->Reset();
+	}
+	PlaceRandomRooms(Params, OutMaze, OutRandStream, OutSpawnCells);
+	if (OutSpawnCells)
+	{
+		// a later room can swallow an earlier room's center.
+		const FMazeGrid& Maze = OutMaze;
+		OutSpawnCells->RemoveAll([&Maze](const int32 Index)
+		{
+			return !Maze.IsSpawn(Index);
+		});
+	}
+	const double RoomsDoneTime = FPlatformTime::Seconds();
+	const int64 RoomsDoneMemory = OutTimings ? int64(FPlatformMemory::GetStats().UsedPhysical) : 0;
+	CarveMaze(OutMaze, Params.MazeDim, OutRandStream, 0, 0, OutSpawnCells);
+	if (OutTimings)
+	{
+		OutTimings->RoomsMs = (RoomsDoneTime - StartTime) * 1000.0;
+		OutTimings->CarveMs = (FPlatformTime::Seconds() - RoomsDoneTime) * 1000.0;
+		OutTimings->RoomsMemoryDelta = RoomsDoneMemory - StartMemory;
+		OutTimings->CarveMemoryDelta = int64(FPlatformMemory::GetStats().UsedPhysical) - RoomsDoneMemory;
+	}
+}
+
+void FMazeCore::Generate(const FMazeCoreParams& Params, FMazeCoreResult& OutResult)
+{
+	Generate(Params, OutResult.Maze, OutResult.RandStream);
+	OutResult.SpawnCells = CollectCells(OutResult.Maze, EMazePlane::Spawn);
+	OutResult.DoorCells = CollectCells(OutResult.Maze, EMazePlane::Door);
+}
+
+TArray<int32> FMazeCore::CollectCells(const FMazeGrid& Maze, const EMazePlane Plane)
+{
+	TArray<int32> Cells;
+	Cells.Reserve(Maze.CountSet(Plane));
+	Maze.ForEachSet(Plane, [&Cells](const int Index)
+	{
+		Cells.Add(Index);
+	});
+	return Cells;
+}
+
+void FMazeCore::PlaceRandomRooms(const FMazeCoreParams& Params, FMazeGrid& Maze, FRandomStream& RandStream, TArray<int32>* OutSpawnCells)
+{
+	const int MazeDim = Params.MazeDim;
+	auto GetIndex = [MazeDim](const int X, const int Y)
+	{
+		return FMazeCore::GetIndex(MazeDim, X, Y);
+	};
+	int MinX = 2;
+	int MaxX = ModAdjust(MazeDim * 0.25f);
+	int MinY = 2;
+	int MaxY = ModAdjust(MazeDim * 0.25f);
+	int LargestYAttained = 0;
+	for (int i = 0; i < Params.MaxRooms; i++)
+	{
+		const int RoomDimIndexX = RandStream.RandRange(0, Params.RoomDims.Num() -1);
+		const int RoomDimIndexY = RandStream.RandRange(0, Params.RoomDims.Num() -1);
+		const int RoomDimX = Params.RoomDims[RoomDimIndexX];
+		const int RoomDimY = Params.RoomDims[RoomDimIndexY];
+		// y comes off the stream before x. this used to be both draws inline in the FVector2d constructor call, which
+		// msvc and gcc evaluate right to left but clang left to right, so the same seed gave different mazes per compiler.
+		const int TopLeftY = ModAdjust(RandStream.RandRange(MinY, MaxY));
+		const int TopLeftX = ModAdjust(RandStream.RandRange(MinX, MaxX));
+		FVector2d TopLeftCorner = FVector2d(TopLeftX, TopLeftY);
+		FVector2d BottomRightCorner = FVector2d(TopLeftCorner.X + RoomDimX, TopLeftCorner.Y + RoomDimY);
+		if (BottomRightCorner.Y > LargestYAttained)
+		{
+			LargestYAttained = BottomRightCorner.Y;
+		}
+		MinX = BottomRightCorner.X + 2;
+		MaxX = MinX + Params.RoomDims[Params.RoomDims.Num()-1];
+		if (TopLeftCorner.X + RoomDimX > MazeDim - 1)
+		{
+			// time to wrap x around to next y part of map
+			MinY = LargestYAttained + 2;
+			MaxY = ModAdjust(MinY + Params.RoomDims[Params.RoomDims.Num()-1]);
+			// reset x
+			MinX = 2;
+			MaxX = ModAdjust(MazeDim * 0.25f);
+		}
+		
+		BottomRightCorner.X = FMath::Min(BottomRightCorner.X, MazeDim -1);
+		BottomRightCorner.Y = FMath::Min(BottomRightCorner.Y, MazeDim -1);
+		if (BottomRightCorner.X - TopLeftCorner.X < Params.RoomDims[0] || BottomRightCorner.Y - TopLeftCorner.Y < Params.RoomDims[0])
+		{
+			// room too smol to be valid. discard.
+			continue;
+		}
+		
+		for (int j = TopLeftCorner.X; j <= BottomRightCorner.X; j++)
+		{
+			for (int k = TopLeftCorner.Y; k <= BottomRightCorner.Y; k++)
+			{
+				int Index = GetIndex(j, k);
+				Maze.SetWall(Index, false);
+				Maze.SetRoom(Index, true);
+				Maze.SetSpawn(Index, false);
+			}
+		}
+		
+		const int RoomCenterX = TopLeftCorner.X + (BottomRightCorner.X - TopLeftCorner.X) / 2;
+		const int RoomCenterY = TopLeftCorner.Y + (BottomRightCorner.Y - TopLeftCorner.Y) / 2;
+		Maze.SetSpawn(GetIndex(RoomCenterX, RoomCenterY), true);
+		if (OutSpawnCells)
+		{
+			OutSpawnCells->AddUnique(GetIndex(RoomCenterX, RoomCenterY));
+		}
+		// put a door in each wall.
+		if (BottomRightCorner.Y < MazeDim - 1)
+		{
+			if (Maze.IsWall(GetIndex(RoomCenterX - 1, BottomRightCorner.Y + 1)) &&
+				Maze.IsWall(GetIndex(RoomCenterX + 1, BottomRightCorner.Y + 1)))
+			{
+				int Index = GetIndex(RoomCenterX, BottomRightCorner.Y + 1);
+				Maze.SetDoor(Index, true);
+				Maze.SetWall(Index, false);
+				Maze.SetDoorRotation(Index, 90.0f);
+			}
+		}
+		if (BottomRightCorner.X < MazeDim - 1)
+		{
+			if (Maze.IsWall(GetIndex(BottomRightCorner.X + 1, RoomCenterY - 1)) &&
+				Maze.IsWall(GetIndex(BottomRightCorner.X + 1, RoomCenterY + 1)))
+			{
+				Maze.SetDoor(GetIndex(BottomRightCorner.X + 1, RoomCenterY), true);
+				Maze.SetWall(GetIndex(BottomRightCorner.X + 1, RoomCenterY), false);
+			}
+		}
+		if (Maze.IsWall(GetIndex(RoomCenterX - 1, TopLeftCorner.Y - 1)) &&
+			Maze.IsWall(GetIndex(RoomCenterX + 1, TopLeftCorner.Y - 1)))
+		{
+			int Index = GetIndex(RoomCenterX, TopLeftCorner.Y - 1);
+			Maze.SetDoor(Index, true);
+			Maze.SetWall(Index, false);
+			Maze.SetDoorRotation(Index, 90.0f);
+		}
+		if (Maze.IsWall(GetIndex(TopLeftCorner.X - 1, RoomCenterY - 1)) &&
+			Maze.IsWall(GetIndex(TopLeftCorner.X - 1, RoomCenterY + 1)))
+		{
+			Maze.SetDoor(GetIndex(TopLeftCorner.X - 1, RoomCenterY), true);
+			Maze.SetWall(GetIndex(TopLeftCorner.X - 1, RoomCenterY), false);
+		}
+	}
+}
+
+// one pending cell of the depth first carve. this is what used to live on the call stack.
+struct FCarveFrame
+{
+	int X;
+	int Y;
+	int Direction;
+	int Attempts;
+	bool bWayFound;
+};
+
+void FMazeCore::CarveMaze(FMazeGrid& Maze, const int MazeDim, FRandomStream& RandStream, const int StartX, const int StartY,
+	TArray<int32>* OutSpawnCells)
+{
+	// explicit stack instead of recursion so deep levels can't blow the stack (especially on worker threads).
+	// cells are visited and the random stream is consumed in the same order as the old recursive version,
+	// so a given seed still carves the exact same maze.
+	TArray<FCarveFrame> Stack;
+	Stack.Reserve(MazeDim);
+	auto EnterCell = [&Maze, &Stack, &RandStream, MazeDim](const int X, const int Y)
+	{
+		Maze.SetWall(Y * MazeDim + X, false);
+		Stack.Add({ X, Y, RandStream.RandRange(0,3), 0, false });
+	};
+	EnterCell(StartX, StartY);
+	while (Stack.Num() > 0)
+	{
+		FCarveFrame& Frame = Stack.Last();
+		if (Frame.Attempts == 4)
+		{
+			if (!Frame.bWayFound)
+			{
+				Maze.SetSpawn(Frame.Y * MazeDim + Frame.X, true);
+				if (OutSpawnCells)
+				{
+					OutSpawnCells->Add(Frame.Y * MazeDim + Frame.X);
+				}
+			}
+			Stack.Pop(false);
+			continue;
+		}
+		// north, south, east, west starting from the random direction picked when we entered the cell.
+		const int Direction = (Frame.Direction + Frame.Attempts) % 4;
+		Frame.Attempts++;
+		int StepX = 0;
+		int StepY = 0;
+		switch (Direction)
+		{
+			case 0: StepY = -1; break;
+			case 1: StepY = 1; break;
+			case 2: StepX = 1; break;
+			default: StepX = -1; break;
+		}
+		const int NextX = Frame.X + StepX * 2;
+		const int NextY = Frame.Y + StepY * 2;
+		if (NextX >= 0 && NextX < MazeDim && NextY >= 0 && NextY < MazeDim && Maze.IsWall(NextY * MazeDim + NextX))
+		{
+			Frame.bWayFound = true;
+			Maze.SetWall((Frame.Y + StepY) * MazeDim + Frame.X + StepX, false);
+			// Frame is invalid after this since the stack may reallocate.
+			EnterCell(NextX, NextY);
+		}
+	}
+}
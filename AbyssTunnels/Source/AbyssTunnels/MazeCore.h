@@ -0,0 +1,86 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+// the maze layout logic with no UObject/engine dependencies, only Core containers and FRandomStream.
+// everything here is plain data in, plain data out, so it can be run and timed without a world.
+
+#include "CoreMinimal.h"
+#include "MazeGrid.h"
+
+// the parts of FMapLevelData the layout depends on.
+struct ABYSSTUNNELS_API FMazeCoreParams
+{
+	int32 Seed = 0;
+	int MazeDim = 31;
+	int MaxRooms = 6;
+	// ascending, RoomDims[0] is the smallest room side that is kept.
+	TArray<int> RoomDims = { 4, 6, 8 };
+};
+
+// wall clock time of each generation phase, for profiling.
+struct FMazeCoreTimings
+{
+	double RoomsMs = 0.0;
+	double CarveMs = 0.0;
+	// change in the process's used physical memory over the phase, in bytes. negative when something got freed.
+	int64 RoomsMemoryDelta = 0;
+	int64 CarveMemoryDelta = 0;
+};
+
+struct ABYSSTUNNELS_API FMazeCoreResult
+{
+	FMazeGrid Maze;
+	// state of the stream after generation. anything else that must stay deterministic carries on from here.
+	FRandomStream RandStream;
+	// cell indices in ascending order.
+	TArray<int32> SpawnCells;
+	TArray<int32> DoorCells;
+};
+
+class ABYSSTUNNELS_API FMazeCore
+{
+public:
+	// rooms first, then the carve from the top left corner. same stream order as the board has always used.
+	// OutSpawnCells gets the spawn cells as they are placed (room centers, then dead ends in carve order) so nobody has
+	// to rescan the grid for them.
+	static void Generate(const FMazeCoreParams& Params, FMazeGrid& OutMaze, FRandomStream& OutRandStream, FMazeCoreTimings* OutTimings = nullptr,
+		TArray<int32>* OutSpawnCells = nullptr);
+	static void Generate(const FMazeCoreParams& Params, FMazeCoreResult& OutResult);
+
+	// OutSpawnCells, when given, gets each room center appended.
+	static void PlaceRandomRooms(const FMazeCoreParams& Params, FMazeGrid& Maze, FRandomStream& RandStream, TArray<int32>* OutSpawnCells = nullptr);
+
+	// carves passages into a solid maze starting from the given cell. OutSpawnCells, when given, gets each dead end appended.
+	static void CarveMaze(FMazeGrid& Maze, const int MazeDim, FRandomStream& RandStream, const int StartX, const int StartY,
+		TArray<int32>* OutSpawnCells = nullptr);
+
+	static TArray<int32> CollectCells(const FMazeGrid& Maze, const EMazePlane Plane);
+
+	// fisher-yates, from the back. RandRange(Min, Max) is inclusive like FMath::RandRange.
+	template<typename ElementType, typename RandRangeType>
+	static void ShuffleCells(TArray<ElementType>& Cells, RandRangeType&& RandRange)
+	{
+		for (int ShuffleIndex = Cells.Num() - 1; ShuffleIndex > 0; --ShuffleIndex)
+		{
+			const int RandomPosition = RandRange(0, ShuffleIndex);
+			Cells.Swap(ShuffleIndex, RandomPosition);
+		}
+	}
+
+	static FORCEINLINE int GetIndex(const int MazeDim, const int X, const int Y)
+	{
+		return Y * MazeDim + X;
+	}
+
+	static FORCEINLINE FIntPoint IndexToCoords(const int MazeDim, const int Index)
+	{
+		return FIntPoint(Index % MazeDim, Index / MazeDim);
+	}
+
+private:
+	static int ModAdjust(int Val)
+	{
+		return (Val % 2 == 0) ? Val : (Val - 1);
+	}
+};
@@ -0,0 +1,67 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MazeDistanceField.h"
+
+void FMazeDistanceField::Build(const FMazeGrid& Maze, const int InSourceCell)
+{
+	const int NumCells = Maze.Num();
+	const int Dim = Maze.GetDim();
+	Distances.SetNumUninitialized(NumCells);
+	for (int32& Distance : Distances)
+	{
+		Distance = Unreachable;
+	}
+	SourceCell = INDEX_NONE;
+	if (!Maze.IsValidIndex(InSourceCell) || Maze.IsWall(InSourceCell))
+	{
+		return;
+	}
+	SourceCell = InSourceCell;
+	// plain array with a read head instead of a ring buffer, every cell is enqueued at most once.
+	Queue.Reset(NumCells);
+	Distances[SourceCell] = 0;
+	Queue.Add(SourceCell);
+	for (int Head = 0; Head < Queue.Num(); ++Head)
+	{
+		const int Index = Queue[Head];
+		const int32 NextDistance = Distances[Index] + 1;
+		const int X = Index % Dim;
+		auto Visit = [this, &Maze, NextDistance](const int Neighbor)
+		{
+			if (Distances[Neighbor] == Unreachable && !Maze.IsWall(Neighbor))
+			{
+				Distances[Neighbor] = NextDistance;
+				Queue.Add(Neighbor);
+			}
+		};
+		if (X > 0)
+		{
+			Visit(Index - 1);
+		}
+		if (X < Dim - 1)
+		{
+			Visit(Index + 1);
+		}
+		if (Index >= Dim)
+		{
+			Visit(Index - Dim);
+		}
+		if (Index + Dim < NumCells)
+		{
+			Visit(Index + Dim);
+		}
+	}
+}
+
+void FMazeDistanceField::Reset()
+{
+	SourceCell = INDEX_NONE;
+	Distances.Empty();
+	Queue.Empty();
+}
+
+SIZE_T FMazeDistanceField::GetAllocatedSize() const
+{
+	return Distances.GetAllocatedSize() + Queue.GetAllocatedSize();
+}
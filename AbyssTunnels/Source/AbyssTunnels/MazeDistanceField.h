@@ -0,0 +1,35 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "MazeGrid.h"
+
+/**
+ * Walking distance (in cells, 4-way) from one source cell to every other cell of the maze, by BFS over the non wall cells.
+ * Lookups are a single array read. Each source gets its own field so when something moves only its field is redone.
+ */
+struct ABYSSTUNNELS_API FMazeDistanceField
+{
+	static constexpr int32 Unreachable = MAX_int32;
+
+	// full BFS out from SourceCell. does nothing useful if the source is a wall or off the grid.
+	void Build(const FMazeGrid& Maze, const int InSourceCell);
+	void Reset();
+
+	FORCEINLINE bool IsBuilt() const { return SourceCell != INDEX_NONE; }
+	FORCEINLINE int GetSourceCell() const { return SourceCell; }
+	FORCEINLINE int32 GetDistance(const int Index) const
+	{
+		return Distances.IsValidIndex(Index) ? Distances[Index] : Unreachable;
+	}
+	FORCEINLINE const TArray<int32>& GetDistances() const { return Distances; }
+
+	SIZE_T GetAllocatedSize() const;
+
+private:
+	int SourceCell = INDEX_NONE;
+	TArray<int32> Distances;
+	// kept around between builds so moving sources don't reallocate.
+	TArray<int32> Queue;
+};
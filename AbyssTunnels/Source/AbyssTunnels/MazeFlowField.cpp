@@ -0,0 +1,102 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MazeFlowField.h"
+
+void FMazeFlowField::BeginBuild(const FMazeGrid& Maze, const int InTargetCell)
+{
+	const int NumCells = Maze.Num();
+	Dim = Maze.GetDim();
+	Distances.SetNumUninitialized(NumCells);
+	for (int32& Distance : Distances)
+	{
+		Distance = MAX_int32;
+	}
+	Directions.SetNumUninitialized(NumCells);
+	FMemory::Memzero(Directions.GetData(), Directions.Num());
+	Queue.Reset(NumCells);
+	QueueHead = 0;
+	TargetCell = INDEX_NONE;
+	bComplete = false;
+	if (!Maze.IsValidIndex(InTargetCell) || Maze.IsWall(InTargetCell))
+	{
+		bComplete = true;
+		return;
+	}
+	TargetCell = InTargetCell;
+	Distances[TargetCell] = 0;
+	Queue.Add(TargetCell);
+}
+
+bool FMazeFlowField::StepBuild(const FMazeGrid& Maze, const int MaxCells)
+{
+	if (bComplete)
+	{
+		return true;
+	}
+	// the maze could have been replaced between slices. nothing sensible to do but stop.
+	if (Maze.Num() != Distances.Num())
+	{
+		Reset();
+		return true;
+	}
+	const int NumCells = Distances.Num();
+	// anything discovered in this slice is expanded in a later one, the BFS order is the same either way.
+	int Budget = FMath::Max(1, MaxCells);
+	while (QueueHead < Queue.Num() && Budget-- > 0)
+	{
+		const int Index = Queue[QueueHead++];
+		const int32 NextDistance = Distances[Index] + 1;
+		const int X = Index % Dim;
+		// the neighbour steps back towards Index, hence the opposite direction.
+		auto Visit = [this, &Maze, NextDistance](const int Neighbor, const EDirection BackDirection)
+		{
+			if (Distances[Neighbor] == MAX_int32 && !Maze.IsWall(Neighbor))
+			{
+				Distances[Neighbor] = NextDistance;
+				Directions[Neighbor] = BackDirection;
+				Queue.Add(Neighbor);
+			}
+		};
+		if (X > 0)
+		{
+			Visit(Index - 1, PosX);
+		}
+		if (X < Dim - 1)
+		{
+			Visit(Index + 1, NegX);
+		}
+		if (Index >= Dim)
+		{
+			Visit(Index - Dim, PosY);
+		}
+		if (Index + Dim < NumCells)
+		{
+			Visit(Index + Dim, NegY);
+		}
+	}
+	bComplete = QueueHead >= Queue.Num();
+	return bComplete;
+}
+
+void FMazeFlowField::Build(const FMazeGrid& Maze, const int InTargetCell)
+{
+	BeginBuild(Maze, InTargetCell);
+	StepBuild(Maze, MAX_int32);
+}
+
+void FMazeFlowField::Reset()
+{
+	TargetCell = INDEX_NONE;
+	Dim = 0;
+	bComplete = false;
+	QueueHead = 0;
+	Queue.Empty();
+	Distances.Empty();
+	Directions.Empty();
+}
+
+SIZE_T FMazeFlowField::GetAllocatedSize() const
+{
+	return Queue.GetAllocatedSize() + Distances.GetAllocatedSize() + Directions.GetAllocatedSize();
+}
@@ -0,0 +1,70 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "MazeGrid.h"
+
+/**
+ * Direction field towards one target cell: every reachable cell stores which neighbour is one step closer,
+ * so steering is a single lookup no matter how many agents use it. Built by BFS out from the target, and the
+ * build can be spread over several frames with StepBuild.
+ */
+struct ABYSSTUNNELS_API FMazeFlowField
+{
+	// which neighbour to step to. None for the target cell itself and for cells the target can't be reached from.
+	enum EDirection : uint8
+	{
+		None,
+		NegX,
+		PosX,
+		NegY,
+		PosY
+	};
+
+	void BeginBuild(const FMazeGrid& Maze, const int InTargetCell);
+	// expands at most MaxCells cells. returns true once the whole field is done.
+	bool StepBuild(const FMazeGrid& Maze, const int MaxCells);
+	// the whole thing in one go.
+	void Build(const FMazeGrid& Maze, const int InTargetCell);
+	void Reset();
+
+	FORCEINLINE bool IsComplete() const { return bComplete; }
+	FORCEINLINE int GetTargetCell() const { return TargetCell; }
+
+	FORCEINLINE EDirection GetDirection(const int Index) const
+	{
+		return Directions.IsValidIndex(Index) ? static_cast<EDirection>(Directions[Index]) : None;
+	}
+
+	// the cell to move into from Index, INDEX_NONE if there is nowhere to go.
+	FORCEINLINE int GetNextCell(const int Index) const
+	{
+		switch (GetDirection(Index))
+		{
+			case NegX: return Index - 1;
+			case PosX: return Index + 1;
+			case NegY: return Index - Dim;
+			case PosY: return Index + Dim;
+			default: return INDEX_NONE;
+		}
+	}
+
+	// steps to the target, MAX_int32 if it can't be reached.
+	FORCEINLINE int32 GetDistance(const int Index) const
+	{
+		return Distances.IsValidIndex(Index) ? Distances[Index] : MAX_int32;
+	}
+
+	SIZE_T GetAllocatedSize() const;
+
+private:
+	int TargetCell = INDEX_NONE;
+	int Dim = 0;
+	bool bComplete = false;
+	// BFS read head into Queue, kept between StepBuild calls.
+	int QueueHead = 0;
+	TArray<int32> Queue;
+	TArray<int32> Distances;
+	TArray<uint8> Directions;
+};
@@ -0,0 +1,193 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MazeFlowFieldSubsystem.h"
+#include "BoardGenerator.h"
+#include "AbyssTunnelsCharacter.h"
+#include "CharacterIndexSubsystem.h"
+
+static TAutoConsoleVariable<int32> CVarFlowFieldCellsPerFrame(
+	TEXT("Abyss.FlowField.CellsPerFrame"),
+	20000,
+	TEXT("How many maze cells the flow field BFS may expand per frame, shared between all players."));
+
+void UMazeFlowFieldSubsystem::SetBoard(ABoardGenerator* InBoard)
+{
+	Board = InBoard;
+	// fields from the last level point into a different maze.
+	Targets.Reset();
+	NextTargetToBuild = 0;
+	RefreshTargets();
+}
+
+void UMazeFlowFieldSubsystem::ClearBoard(ABoardGenerator* InBoard)
+{
+	if (Board.Get() == InBoard)
+	{
+		Board = nullptr;
+		Targets.Reset();
+	}
+}
+
+void UMazeFlowFieldSubsystem::Deinitialize()
+{
+	Board = nullptr;
+	Targets.Empty();
+	Super::Deinitialize();
+}
+
+TStatId UMazeFlowFieldSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UMazeFlowFieldSubsystem, STATGROUP_Tickables);
+}
+
+bool UMazeFlowFieldSubsystem::IsTickable() const
+{
+	return Board.IsValid();
+}
+
+void UMazeFlowFieldSubsystem::RefreshTargets()
+{
+	UCharacterIndexSubsystem* CharacterIndex = UCharacterIndexSubsystem::Get(this);
+	if (!CharacterIndex)
+	{
+		return;
+	}
+	const FCharacterSnapshot& Snapshot = CharacterIndex->GetSnapshot();
+	TSet<AActor*> Players;
+	for (const int32 Entry : Snapshot.PlayerEntries)
+	{
+		Players.Add(Snapshot.Characters[Entry]);
+	}
+	for (int i = Targets.Num() - 1; i >= 0; --i)
+	{
+		AActor* Actor = Targets[i].Actor.Get();
+		if (!Actor || !Players.Contains(Actor))
+		{
+			Targets.RemoveAtSwap(i);
+		}
+		else
+		{
+			Players.Remove(Actor);
+		}
+	}
+	for (AActor* Player : Players)
+	{
+		FMazeFlowTarget& Target = Targets.AddDefaulted_GetRef();
+		Target.Actor = Player;
+	}
+}
+
+void UMazeFlowFieldSubsystem::Tick(float DeltaTime)
+{
+	ABoardGenerator* BoardPtr = Board.Get();
+	if (!BoardPtr)
+	{
+		return;
+	}
+	const FMazeGrid& Maze = BoardPtr->GetMaze();
+	if (Maze.Num() == 0)
+	{
+		return;
+	}
+	RefreshTargets();
+	if (Targets.Num() == 0)
+	{
+		return;
+	}
+
+	// kick off a rebuild for anyone who moved into another cell. a rebuild that is already running for an older
+	// cell just carries on, the next tick notices the player moved again once it is done.
+	for (FMazeFlowTarget& Target : Targets)
+	{
+		const int Cell = BoardPtr->ConvertPositionToMazeIndex(Target.Actor->GetActorLocation());
+		if (!Maze.IsValidIndex(Cell) || Maze.IsWall(Cell) || Target.PendingField != INDEX_NONE)
+		{
+			continue;
+		}
+		if (Target.ActiveField == INDEX_NONE || Target.Fields[Target.ActiveField].GetTargetCell() != Cell)
+		{
+			Target.PendingField = Target.ActiveField == 0 ? 1 : 0;
+			Target.Fields[Target.PendingField].BeginBuild(Maze, Cell);
+		}
+	}
+
+	int Budget = FMath::Max(1, CVarFlowFieldCellsPerFrame.GetValueOnGameThread());
+	for (int i = 0; i < Targets.Num() && Budget > 0; ++i)
+	{
+		FMazeFlowTarget& Target = Targets[(NextTargetToBuild + i) % Targets.Num()];
+		if (Target.PendingField == INDEX_NONE)
+		{
+			continue;
+		}
+		// split what is left between everyone still building.
+		const int Slice = FMath::Max(1, Budget / FMath::Max(1, Targets.Num() - i));
+		Budget -= Slice;
+		if (Target.Fields[Target.PendingField].StepBuild(Maze, Slice))
+		{
+			Target.ActiveField = Target.PendingField;
+			Target.PendingField = INDEX_NONE;
+		}
+	}
+	NextTargetToBuild = (NextTargetToBuild + 1) % Targets.Num();
+}
+
+const FMazeFlowField* UMazeFlowFieldSubsystem::GetFlowField(const AActor* Target) const
+{
+	for (const FMazeFlowTarget& Entry : Targets)
+	{
+		if (Entry.Actor.Get() == Target && Entry.ActiveField != INDEX_NONE)
+		{
+			return &Entry.Fields[Entry.ActiveField];
+		}
+	}
+	return nullptr;
+}
+
+FVector UMazeFlowFieldSubsystem::GetDirectionFromField(const FMazeFlowField& Field, const FVector& Location) const
+{
+	const ABoardGenerator* BoardPtr = Board.Get();
+	if (!BoardPtr)
+	{
+		return FVector::ZeroVector;
+	}
+	const int NextCell = Field.GetNextCell(BoardPtr->ConvertPositionToMazeIndex(Location));
+	if (NextCell == INDEX_NONE)
+	{
+		return FVector::ZeroVector;
+	}
+	const int MazeDim = BoardPtr->GetMaze().GetDim();
+	// aim at the middle of the next cell rather than along the grid axis so agents straighten out in corridors.
+	const FVector NextLocation = BoardPtr->ConvertUnitsToLocation(FVector2d(NextCell % MazeDim, NextCell / MazeDim));
+	return (NextLocation - Location).GetSafeNormal2D();
+}
+
+FVector UMazeFlowFieldSubsystem::GetFlowDirection(const FVector& Location, const AActor* Target) const
+{
+	const FMazeFlowField* Field = GetFlowField(Target);
+	return Field ? GetDirectionFromField(*Field, Location) : FVector::ZeroVector;
+}
+
+FVector UMazeFlowFieldSubsystem::GetFlowDirectionToNearestPlayer(const FVector& Location) const
+{
+	const ABoardGenerator* BoardPtr = Board.Get();
+	if (!BoardPtr)
+	{
+		return FVector::ZeroVector;
+	}
+	const int Cell = BoardPtr->ConvertPositionToMazeIndex(Location);
+	const FMazeFlowField* Nearest = nullptr;
+	for (const FMazeFlowTarget& Entry : Targets)
+	{
+		if (Entry.ActiveField == INDEX_NONE)
+		{
+			continue;
+		}
+		const FMazeFlowField& Field = Entry.Fields[Entry.ActiveField];
+		if (!Nearest || Field.GetDistance(Cell) < Nearest->GetDistance(Cell))
+		{
+			Nearest = &Field;
+		}
+	}
+	return Nearest ? GetDirectionFromField(*Nearest, Location) : FVector::ZeroVector;
+}
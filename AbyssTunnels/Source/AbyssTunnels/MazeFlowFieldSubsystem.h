@@ -0,0 +1,60 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "MazeFlowField.h"
+#include "MazeFlowFieldSubsystem.generated.h"
+
+class ABoardGenerator;
+
+// one player being chased. the active field is what monsters steer by while the pending one is rebuilt for the
+// player's new cell a slice at a time.
+struct FMazeFlowTarget
+{
+	TWeakObjectPtr<AActor> Actor;
+	FMazeFlowField Fields[2];
+	int ActiveField = INDEX_NONE;
+	int PendingField = INDEX_NONE;
+};
+
+/**
+ * Shared flow fields over the maze, one per player. Monsters steer with a single cell lookup instead of each
+ * running its own path query. Fields are rebuilt under a per frame cell budget (Abyss.FlowField.CellsPerFrame)
+ * so a player running around never costs a full BFS in one frame. Only runs on the server, where the AI is.
+ */
+UCLASS()
+class ABYSSTUNNELS_API UMazeFlowFieldSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+public:
+	// the board calls these when a level is committed and torn down.
+	void SetBoard(ABoardGenerator* InBoard);
+	void ClearBoard(ABoardGenerator* InBoard);
+
+	// world space direction (flat, normalized) from Location to the next cell towards Target. zero when Target isn't
+	// a tracked player, its field isn't ready yet or Location is already in the target cell.
+	UFUNCTION(BlueprintPure, Category = "Abyss")
+	FVector GetFlowDirection(const FVector& Location, const AActor* Target) const;
+
+	// same but towards whichever player is the fewest steps away.
+	UFUNCTION(BlueprintPure, Category = "Abyss")
+	FVector GetFlowDirectionToNearestPlayer(const FVector& Location) const;
+
+	const FMazeFlowField* GetFlowField(const AActor* Target) const;
+
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+	virtual bool IsTickable() const override;
+	virtual void Deinitialize() override;
+
+protected:
+	FVector GetDirectionFromField(const FMazeFlowField& Field, const FVector& Location) const;
+	void RefreshTargets();
+
+	TWeakObjectPtr<ABoardGenerator> Board;
+	TArray<FMazeFlowTarget> Targets;
+	// round robin start so one busy target can't starve the others of budget.
+	int NextTargetToBuild = 0;
+};
@@ -0,0 +1,77 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MazeGrid.h"
+
+void FMazeGrid::Init(const int InDim)
+{
+	Dim = InDim;
+	NumCells = Dim * Dim;
+	WordsPerPlane = (NumCells + BitsPerWord - 1) / BitsPerWord;
+	Words.Reset();
+	Words.SetNumZeroed(WordsPerPlane * static_cast<int>(EMazePlane::Num));
+	DoorRotations.Reset();
+	if (WordsPerPlane == 0)
+	{
+		return;
+	}
+	// everything starts out as wall. keep the padding bits of the last word clear so scans never see them.
+	const int WallOffset = PlaneOffset(EMazePlane::Wall);
+	for (int i = 0; i < WordsPerPlane; ++i)
+	{
+		Words[WallOffset + i] = ~uint64(0);
+	}
+	const int UsedBits = NumCells % BitsPerWord;
+	if (UsedBits != 0)
+	{
+		Words[WallOffset + WordsPerPlane - 1] = (uint64(1) << UsedBits) - 1;
+	}
+}
+
+void FMazeGrid::Reset()
+{
+	Dim = 0;
+	NumCells = 0;
+	WordsPerPlane = 0;
+	Words.Empty();
+	DoorRotations.Empty();
+}
+
+float FMazeGrid::GetDoorRotation(const int Index) const
+{
+	const float* Rotation = DoorRotations.Find(Index);
+	return Rotation ? *Rotation : 0.0f;
+}
+
+void FMazeGrid::SetDoorRotation(const int Index, const float Rotation)
+{
+	if (Rotation == 0.0f)
+	{
+		DoorRotations.Remove(Index);
+	}
+	else
+	{
+		DoorRotations.Add(Index, Rotation);
+	}
+}
+
+int FMazeGrid::CountSet(const EMazePlane Plane) const
+{
+	int Count = 0;
+	const int Offset = PlaneOffset(Plane);
+	for (int i = 0; i < WordsPerPlane; ++i)
+	{
+		Count += FMath::CountBits(Words[Offset + i]);
+	}
+	return Count;
+}
+
+bool FMazeGrid::Equals(const FMazeGrid& Other) const
+{
+	return Dim == Other.Dim && Words == Other.Words && DoorRotations.OrderIndependentCompareEqual(Other.DoorRotations);
+}
+
+SIZE_T FMazeGrid::GetAllocatedSize() const
+{
+	return Words.GetAllocatedSize() + DoorRotations.GetAllocatedSize();
+}
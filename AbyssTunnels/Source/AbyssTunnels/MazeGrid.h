@@ -0,0 +1,102 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+// the per cell flags of the maze. each one gets its own bitplane in FMazeGrid.
+enum class EMazePlane : uint8
+{
+	Wall,
+	Room,
+	Spawn,
+	Door,
+	Num
+};
+
+/**
+ * Compact storage for the maze layout. Every flag is one bit per cell in its own plane, so a pass over
+ * the whole grid only touches a few bits per cell and can test 64 cells at a time.
+ * Doors are rare so their rotation lives in a small side table instead of in every cell.
+ */
+struct ABYSSTUNNELS_API FMazeGrid
+{
+	static constexpr int BitsPerWord = 64;
+
+	// resets to a Dim x Dim grid that is solid wall (which is what the carver expects to start from).
+	void Init(const int InDim);
+	void Reset();
+
+	FORCEINLINE int GetDim() const { return Dim; }
+	FORCEINLINE int Num() const { return NumCells; }
+	FORCEINLINE int NumWords() const { return WordsPerPlane; }
+	FORCEINLINE bool IsValidIndex(const int Index) const { return Index >= 0 && Index < NumCells; }
+
+	FORCEINLINE bool Test(const EMazePlane Plane, const int Index) const
+	{
+		return (GetWord(Plane, Index / BitsPerWord) >> (Index % BitsPerWord)) & 1;
+	}
+
+	FORCEINLINE void Set(const EMazePlane Plane, const int Index, const bool bValue)
+	{
+		uint64& Word = Words[PlaneOffset(Plane) + Index / BitsPerWord];
+		const uint64 Mask = uint64(1) << (Index % BitsPerWord);
+		Word = bValue ? (Word | Mask) : (Word & ~Mask);
+	}
+
+	FORCEINLINE bool IsWall(const int Index) const { return Test(EMazePlane::Wall, Index); }
+	FORCEINLINE bool IsRoom(const int Index) const { return Test(EMazePlane::Room, Index); }
+	FORCEINLINE bool IsSpawn(const int Index) const { return Test(EMazePlane::Spawn, Index); }
+	FORCEINLINE bool IsDoor(const int Index) const { return Test(EMazePlane::Door, Index); }
+	FORCEINLINE void SetWall(const int Index, const bool bValue) { Set(EMazePlane::Wall, Index, bValue); }
+	FORCEINLINE void SetRoom(const int Index, const bool bValue) { Set(EMazePlane::Room, Index, bValue); }
+	FORCEINLINE void SetSpawn(const int Index, const bool bValue) { Set(EMazePlane::Spawn, Index, bValue); }
+	FORCEINLINE void SetDoor(const int Index, const bool bValue) { Set(EMazePlane::Door, Index, bValue); }
+
+	float GetDoorRotation(const int Index) const;
+	void SetDoorRotation(const int Index, const float Rotation);
+
+	// word at a time access. bits past the last cell are always zero.
+	FORCEINLINE uint64 GetWord(const EMazePlane Plane, const int WordIndex) const
+	{
+		return Words[PlaneOffset(Plane) + WordIndex];
+	}
+
+	int CountSet(const EMazePlane Plane) const;
+
+	// calls Callback(CellIndex) for every set bit of the plane in ascending cell order
+	// (same order as walking the rows, which matters to anything pulling from the random stream).
+	template<typename FuncType>
+	void ForEachSet(const EMazePlane Plane, FuncType&& Callback) const
+	{
+		const int Offset = PlaneOffset(Plane);
+		for (int WordIndex = 0; WordIndex < WordsPerPlane; ++WordIndex)
+		{
+			uint64 Word = Words[Offset + WordIndex];
+			while (Word)
+			{
+				const int Bit = FMath::CountTrailingZeros64(Word);
+				Callback(WordIndex * BitsPerWord + Bit);
+				Word &= Word - 1;
+			}
+		}
+	}
+
+	// same cells, flags and door rotations.
+	bool Equals(const FMazeGrid& Other) const;
+
+	SIZE_T GetAllocatedSize() const;
+
+private:
+	FORCEINLINE int PlaneOffset(const EMazePlane Plane) const
+	{
+		return static_cast<int>(Plane) * WordsPerPlane;
+	}
+
+	int Dim = 0;
+	int NumCells = 0;
+	int WordsPerPlane = 0;
+	// all planes back to back, WordsPerPlane each.
+	TArray<uint64> Words;
+	TMap<int32, float> DoorRotations;
+};
@@ -0,0 +1,216 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MazeLayoutBuilder.h"
+#include "Async/ParallelFor.h"
+#include "HAL/PlatformMemory.h"
+
+bool FMazeBuildParams::BuildsSameLayout(const FMazeBuildParams& Other) const
+{
+	return LevelData.Level == Other.LevelData.Level && LevelData.Seed == Other.LevelData.Seed
+		&& LevelData.MaxRooms == Other.LevelData.MaxRooms && LevelData.RoomDims == Other.LevelData.RoomDims
+		&& TerrainUnitSize == Other.TerrainUnitSize && OuterWallScaleFactor == Other.OuterWallScaleFactor
+		&& OuterWallMin == Other.OuterWallMin && NumWallVariants == Other.NumWallVariants
+		&& bMergeInnerWalls == Other.bMergeInnerWalls && WallChunkSize == Other.WallChunkSize;
+}
+
+void FMazeLayoutBuilder::Build(const FMazeBuildParams& Params, FMazeLayout& OutLayout)
+{
+	const int MazeDim = Params.LevelData.GetMazeDim();
+	// the grid itself comes from the engine independent core, this only adds the world space side of things.
+	FMazeCore::Generate(MakeCoreParams(Params.LevelData), OutLayout.Maze, OutLayout.RandStream, &OutLayout.CoreTimings, &OutLayout.SpawnCells);
+	FMazeGrid& Maze = OutLayout.Maze;
+	FRandomStream& RandStream = OutLayout.RandStream;
+	const double TransformsStartTime = FPlatformTime::Seconds();
+	const int64 TransformsStartMemory = int64(FPlatformMemory::GetStats().UsedPhysical);
+
+	// enclose the maze with some outer walls.
+	const int OuterWallMin = Params.OuterWallMin;
+	OutLayout.OuterWallTransforms.Reset();
+	OutLayout.OuterWallTransforms.Add(MakeOuterWallTransform(Params, FVector(OuterWallMin, OuterWallMin, 0), FVector(MazeDim, OuterWallMin, 0)));
+	OutLayout.OuterWallTransforms.Add(MakeOuterWallTransform(Params, FVector(OuterWallMin, MazeDim, 0), FVector(MazeDim, MazeDim, 0)));
+	OutLayout.OuterWallTransforms.Add(MakeOuterWallTransform(Params, FVector(OuterWallMin, OuterWallMin, 0), FVector(OuterWallMin, MazeDim, 0)));
+	OutLayout.OuterWallTransforms.Add(MakeOuterWallTransform(Params, FVector(MazeDim, OuterWallMin, 0), FVector(MazeDim, MazeDim, 0)));
+
+	const int ChunksPerSide = GetWallChunksPerSide(Params);
+	OutLayout.NumWallChunks = ChunksPerSide * ChunksPerSide;
+	OutLayout.WallTransforms.Reset();
+	OutLayout.WallTransforms.SetNum(OutLayout.NumWallChunks * Params.NumWallVariants);
+	if (Params.NumWallVariants > 0)
+	{
+		if (Params.bMergeInnerWalls)
+		{
+			BuildMergedWallTransforms(Params, Maze, RandStream, OutLayout);
+		}
+		else
+		{
+			BuildWallTransforms(Params, Maze, RandStream, OutLayout);
+		}
+	}
+
+	OutLayout.DoorTransforms.Reset();
+	Maze.ForEachSet(EMazePlane::Door, [&Params, &OutLayout, &Maze](const int Index)
+	{
+		FTransform Transform = FTransform(GetCellLocation(Params, Index));
+		Transform.SetRotation(FRotator(0, Maze.GetDoorRotation(Index), 0).Quaternion());
+		OutLayout.DoorTransforms.Add(Transform);
+	});
+	OutLayout.TransformsMs = (FPlatformTime::Seconds() - TransformsStartTime) * 1000.0;
+	OutLayout.TransformsMemoryDelta = int64(FPlatformMemory::GetStats().UsedPhysical) - TransformsStartMemory;
+}
+
+void FMazeLayoutBuilder::BuildWallTransforms(const FMazeBuildParams& Params, const FMazeGrid& Maze, FRandomStream& RandStream, FMazeLayout& OutLayout)
+{
+	// the variant picks have to come off the random stream in row order, but that part is cheap.
+	TArray<TArray<int32>> BucketCells;
+	BucketCells.SetNum(OutLayout.WallTransforms.Num());
+	Maze.ForEachSet(EMazePlane::Wall, [&Params, &RandStream, &BucketCells](const int Index)
+	{
+		const int WallIndex = RandStream.RandRange(0, Params.NumWallVariants - 1);
+		BucketCells[GetWallChunk(Params, Index) * Params.NumWallVariants + WallIndex].Add(Index);
+	});
+
+	// building the transforms doesn't depend on anything else so fill each bucket in parallel.
+	const float TerrainUnitSizeMultiplier = Params.LevelData.GetTerrainUnitSizeMultiplier();
+	const FVector TargetScale = FVector(TerrainUnitSizeMultiplier, TerrainUnitSizeMultiplier, Params.OuterWallScaleFactor);
+	for (int Bucket = 0; Bucket < BucketCells.Num(); ++Bucket)
+	{
+		const TArray<int32>& Cells = BucketCells[Bucket];
+		TArray<FTransform>& Transforms = OutLayout.WallTransforms[Bucket];
+		Transforms.SetNumUninitialized(Cells.Num());
+		ParallelFor(Cells.Num(), [&Params, &Cells, &Transforms, &TargetScale](const int32 i)
+		{
+			Transforms[i] = FTransform(FQuat::Identity, GetCellLocation(Params, Cells[i]), TargetScale);
+		});
+	}
+}
+
+void FMazeLayoutBuilder::BuildMergedWallTransforms(const FMazeBuildParams& Params, const FMazeGrid& Maze, FRandomStream& RandStream, FMazeLayout& OutLayout)
+{
+	const int MazeDim = Maze.GetDim();
+	const float TerrainUnitSizeMultiplier = Params.LevelData.GetTerrainUnitSizeMultiplier();
+	const float CellSize = TerrainUnitSizeMultiplier * Params.TerrainUnitSize;
+	// wall cells that haven't been covered by a rectangle yet.
+	TBitArray<> Remaining(false, Maze.Num());
+	Maze.ForEachSet(EMazePlane::Wall, [&Remaining](const int Index)
+	{
+		Remaining[Index] = true;
+	});
+
+	// rectangles come out in row order of their top left cell so the variant picks are deterministic.
+	// they never cross a chunk border so each one belongs to exactly one chunk.
+	const int ChunkSize = Params.WallChunkSize > 0 ? Params.WallChunkSize : MazeDim;
+	for (int Y = 0; Y < MazeDim; ++Y)
+	{
+		const int ChunkEndY = FMath::Min((Y / ChunkSize + 1) * ChunkSize, MazeDim);
+		for (int X = 0; X < MazeDim; ++X)
+		{
+			const int Index = Y * MazeDim + X;
+			if (!Remaining[Index])
+			{
+				continue;
+			}
+			const int ChunkEndX = FMath::Min((X / ChunkSize + 1) * ChunkSize, MazeDim);
+			int Width = 1;
+			while (X + Width < ChunkEndX && Remaining[Index + Width])
+			{
+				Width++;
+			}
+			int Height = 1;
+			while (Y + Height < ChunkEndY)
+			{
+				const int RowStart = (Y + Height) * MazeDim + X;
+				bool bRowIsWall = true;
+				for (int i = 0; i < Width && bRowIsWall; ++i)
+				{
+					bRowIsWall = Remaining[RowStart + i];
+				}
+				if (!bRowIsWall)
+				{
+					break;
+				}
+				Height++;
+			}
+			for (int Row = 0; Row < Height; ++Row)
+			{
+				Remaining.SetRange((Y + Row) * MazeDim + X, Width, false);
+			}
+
+			// centered between the first and last cell, scaled up to cover all of them.
+			const int WallIndex = RandStream.RandRange(0, Params.NumWallVariants - 1);
+			const FVector Location = GetCellLocation(Params, Index) + FVector((Width - 1) * CellSize * 0.5f, (Height - 1) * CellSize * 0.5f, 0);
+			const FVector TargetScale = FVector(TerrainUnitSizeMultiplier * Width, TerrainUnitSizeMultiplier * Height, Params.OuterWallScaleFactor);
+			OutLayout.WallTransforms[GetWallChunk(Params, Index) * Params.NumWallVariants + WallIndex].Add(FTransform(FQuat::Identity, Location, TargetScale));
+		}
+	}
+}
+
+FMazeCoreParams FMazeLayoutBuilder::MakeCoreParams(const FMapLevelData& LevelData)
+{
+	FMazeCoreParams CoreParams;
+	CoreParams.Seed = LevelData.Seed;
+	CoreParams.MazeDim = LevelData.GetMazeDim();
+	CoreParams.MaxRooms = LevelData.MaxRooms;
+	CoreParams.RoomDims = LevelData.RoomDims;
+	return CoreParams;
+}
+
+FVector FMazeLayoutBuilder::GetBaseOffset(const FMazeBuildParams& Params)
+{
+	const float CalcMapDim = Params.LevelData.GetMazeDim() * Params.LevelData.GetTerrainUnitSizeMultiplier();
+	return FVector(Params.TerrainUnitSize * CalcMapDim * -0.5, Params.TerrainUnitSize * CalcMapDim * -0.5, 0);
+}
+
+FVector FMazeLayoutBuilder::GetCellLocation(const FMazeBuildParams& Params, const int Index)
+{
+	const int MazeDim = Params.LevelData.GetMazeDim();
+	const float CellSize = Params.LevelData.GetTerrainUnitSizeMultiplier() * Params.TerrainUnitSize;
+	return GetBaseOffset(Params) + FVector((Index % MazeDim) * CellSize, (Index / MazeDim) * CellSize, 0);
+}
+
+int FMazeLayoutBuilder::GetWallChunksPerSide(const FMazeBuildParams& Params)
+{
+	if (Params.WallChunkSize <= 0)
+	{
+		return 1;
+	}
+	return (Params.LevelData.GetMazeDim() + Params.WallChunkSize - 1) / Params.WallChunkSize;
+}
+
+int FMazeLayoutBuilder::GetWallChunk(const FMazeBuildParams& Params, const int Index)
+{
+	if (Params.WallChunkSize <= 0)
+	{
+		return 0;
+	}
+	const int MazeDim = Params.LevelData.GetMazeDim();
+	const int ChunkX = (Index % MazeDim) / Params.WallChunkSize;
+	const int ChunkY = (Index / MazeDim) / Params.WallChunkSize;
+	return ChunkY * GetWallChunksPerSide(Params) + ChunkX;
+}
+
+FTransform FMazeLayoutBuilder::MakeOuterWallTransform(const FMazeBuildParams& Params, const FVector& StartPos, const FVector& EndPos)
+{
+	const float TerrainUnitSize = Params.TerrainUnitSize;
+	const float OuterWallScaleFactor = Params.OuterWallScaleFactor;
+	const float HorizLength = FMath::Abs(StartPos.X - EndPos.X);
+	const float VertLength = FMath::Abs(StartPos.Y - EndPos.Y);
+	const bool bHorizWall = HorizLength > VertLength;
+	const float TerrainUnitSizeMultiplier = Params.LevelData.GetTerrainUnitSizeMultiplier();
+	const float WallLength = bHorizWall ? HorizLength : VertLength;
+	const FVector WallDirection = (EndPos - StartPos).GetSafeNormal();
+	const FVector WallCenter = StartPos + (WallDirection * WallLength * 0.5f);
+	FVector TargetScale;
+	if (bHorizWall)
+	{
+		TargetScale = FVector(FMath::Max((HorizLength + 1) * TerrainUnitSizeMultiplier, TerrainUnitSizeMultiplier), TerrainUnitSizeMultiplier, OuterWallScaleFactor);
+	}
+	else
+	{
+		TargetScale = FVector(TerrainUnitSizeMultiplier, FMath::Max((VertLength + 1) * TerrainUnitSizeMultiplier, TerrainUnitSizeMultiplier), OuterWallScaleFactor);
+	}
+	const FVector Location = GetBaseOffset(Params) + (WallCenter * TerrainUnitSizeMultiplier * TerrainUnitSize) + (bHorizWall?FVector(1,1,0):FVector::ZeroVector) + FVector(0,0,(TerrainUnitSize * OuterWallScaleFactor * 0.5f));
+	FTransform Transform = FTransform(Location);
+	Transform.SetScale3D(TargetScale);
+	return Transform;
+}
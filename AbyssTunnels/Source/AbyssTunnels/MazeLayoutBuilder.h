@@ -0,0 +1,72 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "MapLevelData.h"
+#include "MazeCore.h"
+
+// everything the layout generation needs from the board. it is a copy so the build can run off the game thread.
+struct ABYSSTUNNELS_API FMazeBuildParams
+{
+	FMapLevelData LevelData;
+	float TerrainUnitSize = 100.f;
+	float OuterWallScaleFactor = 20.f;
+	int OuterWallMin = -1;
+	int NumWallVariants = 0;
+	// merge runs/rectangles of inner wall cells into single scaled instances.
+	bool bMergeInnerWalls = false;
+	// side length in cells of the spatial chunks walls are bucketed into. 0 keeps the whole maze as one chunk.
+	int WallChunkSize = 0;
+
+	// true when building with Other gives the same layout, i.e. everything the build reads is equal.
+	bool BuildsSameLayout(const FMazeBuildParams& Other) const;
+};
+
+// a finished level layout. all that is left is committing it to components and actors on the game thread.
+struct ABYSSTUNNELS_API FMazeLayout
+{
+	FMazeGrid Maze;
+	// state of the stream after generation so the board can carry on from where the build left off.
+	FRandomStream RandStream;
+	TArray<FTransform> OuterWallTransforms;
+	// inner wall instances bucketed by chunk and then variant, WallTransforms[Chunk * NumWallVariants + Variant].
+	// without chunking there is a single chunk covering the whole maze.
+	TArray<TArray<FTransform>> WallTransforms;
+	int NumWallChunks = 1;
+	// unscaled, the board applies DoorScale after spawning like it always has.
+	TArray<FTransform> DoorTransforms;
+	// every spawn cell, collected while the maze was generated. not in any particular order, the board shuffles them.
+	TArray<int32> SpawnCells;
+	FMazeCoreTimings CoreTimings;
+	double TransformsMs = 0.0;
+	int64 TransformsMemoryDelta = 0;
+};
+
+/**
+ * Builds level layouts: the FMazeCore grid plus all the world space transforms the board needs.
+ * Nothing in here touches a UObject so it is safe to run on a worker thread.
+ * The random stream is consumed rooms -> carve -> wall variants, the same order on server and clients.
+ */
+class ABYSSTUNNELS_API FMazeLayoutBuilder
+{
+public:
+	static void Build(const FMazeBuildParams& Params, FMazeLayout& OutLayout);
+
+	static FMazeCoreParams MakeCoreParams(const FMapLevelData& LevelData);
+
+	static FVector GetBaseOffset(const FMazeBuildParams& Params);
+
+	// just for the outer walls to make it so they are contiguous instead of being made of units.
+	static FTransform MakeOuterWallTransform(const FMazeBuildParams& Params, const FVector& StartPos, const FVector& EndPos);
+
+	static FVector GetCellLocation(const FMazeBuildParams& Params, const int Index);
+
+	static int GetWallChunksPerSide(const FMazeBuildParams& Params);
+	static int GetWallChunk(const FMazeBuildParams& Params, const int Index);
+
+private:
+	static void BuildWallTransforms(const FMazeBuildParams& Params, const FMazeGrid& Maze, FRandomStream& RandStream, FMazeLayout& OutLayout);
+	// greedily covers the wall cells with rectangles (widest run first, then grown down) and emits one instance each.
+	static void BuildMergedWallTransforms(const FMazeBuildParams& Params, const FMazeGrid& Maze, FRandomStream& RandStream, FMazeLayout& OutLayout);
+};
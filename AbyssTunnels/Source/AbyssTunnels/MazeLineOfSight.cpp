@@ -0,0 +1,87 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MazeLineOfSight.h"
+
+EMazeSight FMazeLineOfSight::Trace(const FMazeGrid& Maze, const FVector2D& Start, const FVector2D& End)
+{
+	const int Dim = Maze.GetDim();
+	if (Dim == 0)
+	{
+		return EMazeSight::Unknown;
+	}
+	// shift by half a cell so cell X covers [X, X + 1) and floor gives the cell.
+	const double StartX = Start.X + 0.5;
+	const double StartY = Start.Y + 0.5;
+	const double DeltaX = End.X - Start.X;
+	const double DeltaY = End.Y - Start.Y;
+	int CellX = FMath::FloorToInt(StartX);
+	int CellY = FMath::FloorToInt(StartY);
+	const int EndCellX = FMath::FloorToInt(End.X + 0.5);
+	const int EndCellY = FMath::FloorToInt(End.Y + 0.5);
+	const int StepX = DeltaX > 0 ? 1 : -1;
+	const int StepY = DeltaY > 0 ? 1 : -1;
+	// t (0..1 along the segment) at which we cross the next x/y cell boundary, and how far t moves per cell.
+	const double TDeltaX = DeltaX != 0 ? FMath::Abs(1.0 / DeltaX) : BIG_NUMBER;
+	const double TDeltaY = DeltaY != 0 ? FMath::Abs(1.0 / DeltaY) : BIG_NUMBER;
+	double TMaxX = DeltaX > 0 ? (CellX + 1 - StartX) / DeltaX : DeltaX < 0 ? (StartX - CellX) / -DeltaX : BIG_NUMBER;
+	double TMaxY = DeltaY > 0 ? (CellY + 1 - StartY) / DeltaY : DeltaY < 0 ? (StartY - CellY) / -DeltaY : BIG_NUMBER;
+
+	bool bCrossesDoor = false;
+	// returns false if the cell decides the answer (off grid or wall).
+	auto VisitCell = [&Maze, &bCrossesDoor, Dim](const int X, const int Y, EMazeSight& OutSight)
+	{
+		if (X < 0 || X >= Dim || Y < 0 || Y >= Dim)
+		{
+			OutSight = EMazeSight::Unknown;
+			return false;
+		}
+		const int Index = Y * Dim + X;
+		if (Maze.IsWall(Index))
+		{
+			OutSight = EMazeSight::Blocked;
+			return false;
+		}
+		bCrossesDoor |= Maze.IsDoor(Index);
+		return true;
+	};
+
+	EMazeSight Sight = EMazeSight::Clear;
+	// the endpoints are characters, if one of them maps into a wall the grid is not the whole story.
+	const int MaxSteps = FMath::Abs(EndCellX - CellX) + FMath::Abs(EndCellY - CellY);
+	for (int Step = 0; ; ++Step)
+	{
+		if (!VisitCell(CellX, CellY, Sight))
+		{
+			return (Step == 0 || Step == MaxSteps) && Sight == EMazeSight::Blocked ? EMazeSight::Unknown : Sight;
+		}
+		if ((CellX == EndCellX && CellY == EndCellY) || Step >= MaxSteps)
+		{
+			break;
+		}
+		if (TMaxX < TMaxY)
+		{
+			CellX += StepX;
+			TMaxX += TDeltaX;
+		}
+		else if (TMaxY < TMaxX)
+		{
+			CellY += StepY;
+			TMaxY += TDeltaY;
+		}
+		else
+		{
+			// straight through a corner. a trace there would clip either of the two side cells, so both have to be open.
+			if (!VisitCell(CellX + StepX, CellY, Sight) || !VisitCell(CellX, CellY + StepY, Sight))
+			{
+				return Sight;
+			}
+			CellX += StepX;
+			CellY += StepY;
+			TMaxX += TDeltaX;
+			TMaxY += TDeltaY;
+			++Step;
+		}
+	}
+	return bCrossesDoor ? EMazeSight::Unknown : EMazeSight::Clear;
+}
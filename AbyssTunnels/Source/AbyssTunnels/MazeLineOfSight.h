@@ -0,0 +1,25 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "MazeGrid.h"
+
+enum class EMazeSight : uint8
+{
+	Clear,
+	Blocked,
+	// the segment leaves the grid or crosses a door cell. the grid can't say, ask physics.
+	Unknown
+};
+
+/**
+ * Line of sight over the maze grid by walking the cells the segment crosses (Amanatides & Woo DDA).
+ * Walls are exactly the wall cells so no physics is needed for them. Positions are in cell units where cell
+ * X,Y is centered on X,Y (same as ABoardGenerator::ConvertUnitsToLocation).
+ */
+class ABYSSTUNNELS_API FMazeLineOfSight
+{
+public:
+	static EMazeSight Trace(const FMazeGrid& Maze, const FVector2D& Start, const FVector2D& End);
+};
@@ -0,0 +1,138 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MazeVisibilitySet.h"
+#include "Async/ParallelFor.h"
+
+static_assert(FMazeVisibilitySet::WordsPerWindow <= 16, "cell masks are 16 bits");
+
+void FMazeVisibilitySet::Build(const FMazeGrid& Maze, const int InRadius)
+{
+	Dim = Maze.GetDim();
+	Radius = FMath::Clamp(InRadius, 1, MaxRadius);
+	const int NumCells = Maze.Num();
+	CellOffsets.SetNumZeroed(NumCells);
+	CellMasks.SetNumZeroed(NumCells);
+	DoorInWindow.Init(false, NumCells);
+	Words.Reset();
+
+	// rows are independent so each one fills its own buffer and they get packed together afterwards.
+	struct FRowResult
+	{
+		TArray<uint64> Words;
+		TArray<uint16> Masks;
+		TArray<bool> Doors;
+	};
+	TArray<FRowResult> Rows;
+	Rows.SetNum(Dim);
+	const int RadiusSquared = Radius * Radius;
+	ParallelFor(Dim, [this, &Maze, &Rows, RadiusSquared](const int32 Y)
+	{
+		FRowResult& Row = Rows[Y];
+		Row.Masks.SetNumZeroed(Dim);
+		Row.Doors.SetNumZeroed(Dim);
+		for (int X = 0; X < Dim; ++X)
+		{
+			const int Index = Y * Dim + X;
+			if (Maze.IsWall(Index))
+			{
+				continue;
+			}
+			uint64 Window[WordsPerWindow] = {};
+			const FVector2D From(X, Y);
+			for (int DY = -Radius; DY <= Radius; ++DY)
+			{
+				const int ToY = Y + DY;
+				if (ToY < 0 || ToY >= Dim)
+				{
+					continue;
+				}
+				for (int DX = -Radius; DX <= Radius; ++DX)
+				{
+					const int ToX = X + DX;
+					if (ToX < 0 || ToX >= Dim || DX * DX + DY * DY > RadiusSquared)
+					{
+						continue;
+					}
+					const int ToIndex = ToY * Dim + ToX;
+					if (Maze.IsWall(ToIndex))
+					{
+						continue;
+					}
+					Row.Doors[X] |= Maze.IsDoor(ToIndex);
+					// Unknown here can only be a door in the way, which counts as not blocked by walls.
+					if (FMazeLineOfSight::Trace(Maze, From, FVector2D(ToX, ToY)) != EMazeSight::Blocked)
+					{
+						const uint32 Bit = GetWindowBit(DX + HalfWindow, DY + HalfWindow);
+						Window[Bit / 64] |= uint64(1) << (Bit % 64);
+					}
+				}
+			}
+			uint16 Mask = 0;
+			for (int Word = 0; Word < WordsPerWindow; ++Word)
+			{
+				if (Window[Word])
+				{
+					Mask |= 1 << Word;
+					Row.Words.Add(Window[Word]);
+				}
+			}
+			Row.Masks[X] = Mask;
+		}
+	});
+
+	int TotalWords = 0;
+	for (const FRowResult& Row : Rows)
+	{
+		TotalWords += Row.Words.Num();
+	}
+	Words.Reserve(TotalWords);
+	for (int Y = 0; Y < Dim; ++Y)
+	{
+		const FRowResult& Row = Rows[Y];
+		int RowWord = 0;
+		for (int X = 0; X < Dim; ++X)
+		{
+			const int Index = Y * Dim + X;
+			CellOffsets[Index] = Words.Num();
+			CellMasks[Index] = Row.Masks[X];
+			DoorInWindow[Index] = Row.Doors[X];
+			const int NumWords = FMath::CountBits(Row.Masks[X]);
+			Words.Append(Row.Words.GetData() + RowWord, NumWords);
+			RowWord += NumWords;
+		}
+	}
+}
+
+EMazeSight FMazeVisibilitySet::Query(const int FromIndex, const int ToIndex) const
+{
+	if (!CellMasks.IsValidIndex(FromIndex) || !CellMasks.IsValidIndex(ToIndex) || CellMasks[FromIndex] == 0 || CellMasks[ToIndex] == 0)
+	{
+		return EMazeSight::Unknown;
+	}
+	const int DX = ToIndex % Dim - FromIndex % Dim;
+	const int DY = ToIndex / Dim - FromIndex / Dim;
+	if (DX * DX + DY * DY > Radius * Radius)
+	{
+		return EMazeSight::Unknown;
+	}
+	const uint32 Bit = GetWindowBit(DX + HalfWindow, DY + HalfWindow);
+	const uint32 Word = Bit / 64;
+	const uint16 Mask = CellMasks[FromIndex];
+	if (!(Mask & (1 << Word)))
+	{
+		return EMazeSight::Blocked;
+	}
+	// stored words are packed, so skip however many stored words come before this one.
+	const uint32 Packed = CellOffsets[FromIndex] + FMath::CountBits(Mask & ((1u << Word) - 1));
+	if (!((Words[Packed] >> (Bit % 64)) & 1))
+	{
+		return EMazeSight::Blocked;
+	}
+	return DoorInWindow[FromIndex] ? EMazeSight::Unknown : EMazeSight::Clear;
+}
+
+SIZE_T FMazeVisibilitySet::GetAllocatedSize() const
+{
+	return CellOffsets.GetAllocatedSize() + CellMasks.GetAllocatedSize() + Words.GetAllocatedSize() + DoorInWindow.GetAllocatedSize();
+}
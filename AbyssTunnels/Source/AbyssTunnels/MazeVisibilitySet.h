@@ -0,0 +1,56 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "MazeGrid.h"
+#include "MazeLineOfSight.h"
+
+/**
+ * Precomputed cell to cell visibility (potentially visible set) for a finished maze, capped to a radius around
+ * each cell. Every open cell gets a 32x32 window bitset around itself in Morton order, so the cells along a
+ * corridor land in the same few words, and only the non zero words are stored. "Visible" means no wall cell in
+ * between. Doors are left to the DDA/physics, each cell just remembers whether a door is inside its window.
+ */
+struct ABYSSTUNNELS_API FMazeVisibilitySet
+{
+	static constexpr int WindowSize = 32;
+	static constexpr int HalfWindow = WindowSize / 2;
+	static constexpr int WordsPerWindow = WindowSize * WindowSize / 64;
+	// cells further out than this can't be represented in the window.
+	static constexpr int MaxRadius = HalfWindow - 1;
+
+	// runs the grid line of sight for every pair of open cells within Radius. expensive, run it off the game thread.
+	void Build(const FMazeGrid& Maze, const int InRadius);
+
+	// Clear/Blocked if the set knows, Unknown if either cell is a wall, the pair is out of range or a door might be in the way.
+	EMazeSight Query(const int FromIndex, const int ToIndex) const;
+
+	FORCEINLINE int GetDim() const { return Dim; }
+	FORCEINLINE int GetRadius() const { return Radius; }
+	int GetNumWords() const { return Words.Num(); }
+	SIZE_T GetAllocatedSize() const;
+
+private:
+	static FORCEINLINE uint32 SpreadBits(uint32 Value)
+	{
+		// 5 bits -> every other bit of 10.
+		Value = (Value | (Value << 4)) & 0x0F0F;
+		Value = (Value | (Value << 2)) & 0x3333;
+		Value = (Value | (Value << 1)) & 0x5555;
+		return Value;
+	}
+
+	static FORCEINLINE uint32 GetWindowBit(const int LocalX, const int LocalY)
+	{
+		return SpreadBits(LocalX) | (SpreadBits(LocalY) << 1);
+	}
+
+	int Dim = 0;
+	int Radius = 0;
+	// per cell: where its stored words start and which of the WordsPerWindow words are stored. 0 mask = no data (wall).
+	TArray<uint32> CellOffsets;
+	TArray<uint16> CellMasks;
+	TArray<uint64> Words;
+	TBitArray<> DoorInWindow;
+};
@@ -0,0 +1,150 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MonsterSpawnDirector.h"
+#include "AbyssTunnelsCharacter.h"
+#include "BoardGenerator.h"
+
+static TAutoConsoleVariable<float> CVarSpawnDirectorBudgetMs(
+	TEXT("Abyss.SpawnDirector.BudgetMs"),
+	2.0f,
+	TEXT("Milliseconds per frame the spawn director may spend spawning monsters. At least one is always spawned when one is due."));
+
+// the old pick walked the eligible monsters and swapped to each next one with this chance.
+static constexpr float MonsterReplaceChance = 0.4f;
+
+UMonsterSpawnDirector* UMonsterSpawnDirector::Get(const UObject* WorldContextObject)
+{
+	if (const UWorld* World = GEngine->GetWorldFromContextObject(WorldContextObject, EGetWorldErrorMode::ReturnNull))
+	{
+		return World->GetSubsystem<UMonsterSpawnDirector>();
+	}
+	return nullptr;
+}
+
+TStatId UMonsterSpawnDirector::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UMonsterSpawnDirector, STATGROUP_Tickables);
+}
+
+bool UMonsterSpawnDirector::IsTickable() const
+{
+	const UWorld* World = GetWorld();
+	return World && World->GetNetMode() != NM_Client && Board.IsValid();
+}
+
+void UMonsterSpawnDirector::SetBoard(ABoardGenerator* InBoard)
+{
+	Board = InBoard;
+	MonsterClasses.Reset();
+	Sampler = FSpawnAliasSampler();
+	PendingFill = 0;
+	if (!InBoard)
+	{
+		return;
+	}
+	const int Level = InBoard->CurrentMapLevelData.Level;
+	TArray<int> MinimumLevels;
+	for (const auto& Entry : InBoard->SpawnableMonsters)
+	{
+		if (Entry.Key <= Level && !Entry.Value.IsNull())
+		{
+			MinimumLevels.Add(Entry.Key);
+		}
+	}
+	MinimumLevels.Sort();
+	for (const int MinimumLevel : MinimumLevels)
+	{
+		MonsterClasses.Add(InBoard->SpawnableMonsters[MinimumLevel]);
+	}
+	// the same odds the old walk gave, with the walk going from the lowest minimum level up, so newer monsters
+	// stay the more likely ones: the last one is kept with MonsterReplaceChance, the one before that with
+	// MonsterReplaceChance of what is left, and so on down to the first which keeps the rest.
+	const int NumClasses = MonsterClasses.Num();
+	TArray<float> Weights;
+	TArray<int32> Entries;
+	Weights.SetNumUninitialized(NumClasses);
+	for (int i = 0; i < NumClasses; ++i)
+	{
+		const float Kept = FMath::Pow(1.f - MonsterReplaceChance, NumClasses - 1 - i);
+		Weights[i] = i == 0 ? Kept : MonsterReplaceChance * Kept;
+		Entries.Add(i);
+	}
+	Sampler.Build(Entries, Weights);
+
+	PendingFill = FMath::CeilToInt(GetTargetPopulation() * FMath::Clamp(InBoard->InitialMonsterFraction, 0.f, 1.f));
+	if (const UWorld* World = GetWorld())
+	{
+		NextTrickleTime = World->GetTimeSeconds() + InBoard->MonsterSpawnInterval;
+	}
+}
+
+void UMonsterSpawnDirector::ClearBoard(ABoardGenerator* InBoard)
+{
+	if (Board.Get() == InBoard)
+	{
+		Board = nullptr;
+		MonsterClasses.Reset();
+		Sampler = FSpawnAliasSampler();
+		PendingFill = 0;
+	}
+}
+
+void UMonsterSpawnDirector::Deinitialize()
+{
+	Board = nullptr;
+	MonsterClasses.Empty();
+	Super::Deinitialize();
+}
+
+TSubclassOf<AAbyssTunnelsCharacter> UMonsterSpawnDirector::PickMonsterClass(FRandomStream& RandStream) const
+{
+	return Sampler.IsEmpty() ? nullptr : MonsterClasses[Sampler.Sample(RandStream)].LoadSynchronous();
+}
+
+int UMonsterSpawnDirector::GetTargetPopulation() const
+{
+	const ABoardGenerator* CurrentBoard = Board.Get();
+	const UWorld* World = GetWorld();
+	if (!CurrentBoard || !World)
+	{
+		return 0;
+	}
+	return World->GetNumPlayerControllers() + CurrentBoard->CurrentMapLevelData.MaximumMonsters();
+}
+
+void UMonsterSpawnDirector::Tick(float DeltaTime)
+{
+	ABoardGenerator* CurrentBoard = Board.Get();
+	const UWorld* World = GetWorld();
+	if (!CurrentBoard || !World || Sampler.IsEmpty())
+	{
+		return;
+	}
+	const int Missing = GetTargetPopulation() - CurrentBoard->ActiveMonsters.Num();
+	if (Missing <= 0)
+	{
+		PendingFill = 0;
+		return;
+	}
+	int Due = FMath::Min(PendingFill, Missing);
+	if (Due == 0 && World->GetTimeSeconds() >= NextTrickleTime)
+	{
+		Due = 1;
+		NextTrickleTime = World->GetTimeSeconds() + CurrentBoard->MonsterSpawnInterval;
+	}
+	const double BudgetSeconds = CVarSpawnDirectorBudgetMs.GetValueOnGameThread() / 1000.0;
+	const double StartTime = FPlatformTime::Seconds();
+	int Spawned = 0;
+	while (Due > 0 && (Spawned == 0 || FPlatformTime::Seconds() - StartTime < BudgetSeconds))
+	{
+		// no free cell far enough from the players, the board reshuffled so try again next frame.
+		if (!CurrentBoard->SpawnRandomMonster())
+		{
+			break;
+		}
+		Spawned++;
+		Due--;
+		PendingFill = FMath::Max(PendingFill - 1, 0);
+	}
+}
@@ -0,0 +1,50 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "ItemSpawnPlanner.h"
+#include "MonsterSpawnDirector.generated.h"
+
+class ABoardGenerator;
+class AAbyssTunnelsCharacter;
+
+/**
+ * Decides when and what monsters the board spawns. Server only.
+ * When a level is committed the monsters allowed on it (SpawnableMonsters key <= level) are compiled into a weighted
+ * table once. Right after the transition InitialMonsterFraction of the cap is spawned as fast as the frame budget
+ * (Abyss.SpawnDirector.BudgetMs) allows, after that one monster per MonsterSpawnInterval tops the population back up.
+ * The population itself is the board's ActiveMonsters, which drops monsters as they are destroyed.
+ */
+UCLASS()
+class ABYSSTUNNELS_API UMonsterSpawnDirector : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+public:
+	static UMonsterSpawnDirector* Get(const UObject* WorldContextObject);
+
+	// the board calls these when a level is committed and torn down.
+	void SetBoard(ABoardGenerator* InBoard);
+	void ClearBoard(ABoardGenerator* InBoard);
+
+	// null when nothing can spawn on this level. the class is normally already in from USpawnClassPreloader.
+	TSubclassOf<AAbyssTunnelsCharacter> PickMonsterClass(FRandomStream& RandStream) const;
+
+	// ConnectedPlayers + the level's MaximumMonsters, same cap the board always used.
+	int GetTargetPopulation() const;
+
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+	virtual bool IsTickable() const override;
+	virtual void Deinitialize() override;
+
+protected:
+	TWeakObjectPtr<ABoardGenerator> Board;
+	// ascending minimum level, Sampler picks an index into this.
+	TArray<TSoftClassPtr<AAbyssTunnelsCharacter>> MonsterClasses;
+	FSpawnAliasSampler Sampler;
+	// still to come from the fill after the level transition.
+	int PendingFill = 0;
+	double NextTrickleTime = 0.0;
+};
@@ -0,0 +1,145 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "PerceptionSubsystem.h"
+#include "AbyssTunnelsCharacter.h"
+#include "AbyssTunnelsGameplayStatics.h"
+#include "CharacterIndexSubsystem.h"
+#include "Math/VectorRegister.h"
+
+static TAutoConsoleVariable<bool> CVarPerceptionEnabled(
+	TEXT("Abyss.Perception.Enabled"),
+	true,
+	TEXT("Update monster stealth perception centrally in UPerceptionSubsystem instead of in each UpdatePlayerSeeing call."));
+
+static TAutoConsoleVariable<int32> CVarPerceptionPairsPerFrame(
+	TEXT("Abyss.Perception.PairsPerFrame"),
+	128,
+	TEXT("How many monster/player pairs perception may look at per frame. Monsters past the budget wait for a later frame."));
+
+bool UPerceptionSubsystem::IsEnabled()
+{
+	return CVarPerceptionEnabled.GetValueOnGameThread();
+}
+
+TStatId UPerceptionSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UPerceptionSubsystem, STATGROUP_Tickables);
+}
+
+bool UPerceptionSubsystem::IsTickable() const
+{
+	const UWorld* World = GetWorld();
+	return World && World->GetNetMode() != NM_Client && IsEnabled();
+}
+
+void UPerceptionSubsystem::Tick(float DeltaTime)
+{
+	LastPairsChecked = 0;
+	LastSightChecks = 0;
+	UCharacterIndexSubsystem* CharacterIndex = UCharacterIndexSubsystem::Get(this);
+	if (!CharacterIndex)
+	{
+		return;
+	}
+	const FCharacterSnapshot& Snapshot = CharacterIndex->GetSnapshot();
+	const int NumPlayers = Snapshot.PlayerEntries.Num();
+	const int NumMonsters = Snapshot.MonsterEntries.Num();
+	if (NumMonsters == 0)
+	{
+		return;
+	}
+
+	// pack the players into lanes. results for the padding lanes are never read.
+	const int NumLanes = Align(FMath::Max(NumPlayers, 1), 4);
+	for (TArray<float>* Lane : { &PlayerX, &PlayerY, &PlayerZ, &PlayerForwardX, &PlayerForwardY, &PlayerForwardZ })
+	{
+		Lane->SetNumUninitialized(NumLanes);
+		FMemory::Memzero(Lane->GetData(), NumLanes * sizeof(float));
+	}
+	Players.Reset(NumPlayers);
+	for (int i = 0; i < NumPlayers; ++i)
+	{
+		const int32 Entry = Snapshot.PlayerEntries[i];
+		PlayerX[i] = Snapshot.X[Entry];
+		PlayerY[i] = Snapshot.Y[Entry];
+		PlayerZ[i] = Snapshot.Z[Entry];
+		PlayerForwardX[i] = Snapshot.ForwardX[Entry];
+		PlayerForwardY[i] = Snapshot.ForwardY[Entry];
+		PlayerForwardZ[i] = Snapshot.ForwardZ[Entry];
+		Players.Add(Snapshot.Characters[Entry]);
+	}
+
+	MonsterOrder = Snapshot.MonsterEntries;
+	MonsterOrder.Sort([&Snapshot](const int32 A, const int32 B)
+	{
+		return Snapshot.Characters[A]->GetUniqueID() < Snapshot.Characters[B]->GetUniqueID();
+	});
+	// carry on from the first monster after the last one we got to.
+	int Cursor = 0;
+	while (Cursor < NumMonsters && Snapshot.Characters[MonsterOrder[Cursor]]->GetUniqueID() < NextMonsterId)
+	{
+		Cursor++;
+	}
+	const int Budget = FMath::Max(1, CVarPerceptionPairsPerFrame.GetValueOnGameThread());
+	const int MonstersThisFrame = FMath::Clamp(Budget / FMath::Max(NumPlayers, 1), 1, NumMonsters);
+
+	// IsCharacterFacing is dot(normalize(To), Forward) > 0.2. squared to drop the sqrt: dot > 0 && dot^2 > 0.04 |To|^2.
+	const VectorRegister4Float Zero = VectorZeroFloat();
+	const VectorRegister4Float ThresholdSquared = VectorSetFloat1(0.2f * 0.2f);
+	for (int Processed = 0; Processed < MonstersThisFrame; ++Processed)
+	{
+		const int32 Entry = MonsterOrder[(Cursor + Processed) % NumMonsters];
+		AAbyssTunnelsCharacter* Monster = Snapshot.Characters[Entry];
+		const VectorRegister4Float MonsterX = VectorSetFloat1(Snapshot.X[Entry]);
+		const VectorRegister4Float MonsterY = VectorSetFloat1(Snapshot.Y[Entry]);
+		const VectorRegister4Float MonsterZ = VectorSetFloat1(Snapshot.Z[Entry]);
+		const VectorRegister4Float MonsterForwardX = VectorSetFloat1(Snapshot.ForwardX[Entry]);
+		const VectorRegister4Float MonsterForwardY = VectorSetFloat1(Snapshot.ForwardY[Entry]);
+		const VectorRegister4Float MonsterForwardZ = VectorSetFloat1(Snapshot.ForwardZ[Entry]);
+		bool bIsSeenByPlayer = false;
+		Monster->SeenCharacters.Reset();
+		for (int Lane = 0; Lane < NumPlayers; Lane += 4)
+		{
+			const VectorRegister4Float ToX = VectorSubtract(VectorLoad(&PlayerX[Lane]), MonsterX);
+			const VectorRegister4Float ToY = VectorSubtract(VectorLoad(&PlayerY[Lane]), MonsterY);
+			const VectorRegister4Float ToZ = VectorSubtract(VectorLoad(&PlayerZ[Lane]), MonsterZ);
+			const VectorRegister4Float LengthSquared = VectorMultiplyAdd(ToX, ToX, VectorMultiplyAdd(ToY, ToY, VectorMultiply(ToZ, ToZ)));
+			const VectorRegister4Float MinDotSquared = VectorMultiply(LengthSquared, ThresholdSquared);
+			// monster looking at the player.
+			const VectorRegister4Float MonsterDot = VectorMultiplyAdd(ToX, MonsterForwardX, VectorMultiplyAdd(ToY, MonsterForwardY, VectorMultiply(ToZ, MonsterForwardZ)));
+			const int MonsterFacing = VectorMaskBits(VectorBitwiseAnd(VectorCompareGT(MonsterDot, Zero),
+				VectorCompareGT(VectorMultiply(MonsterDot, MonsterDot), MinDotSquared)));
+			// player looking back at the monster, along -To.
+			const VectorRegister4Float PlayerDot = VectorNegate(VectorMultiplyAdd(ToX, VectorLoad(&PlayerForwardX[Lane]),
+				VectorMultiplyAdd(ToY, VectorLoad(&PlayerForwardY[Lane]), VectorMultiply(ToZ, VectorLoad(&PlayerForwardZ[Lane])))));
+			const int PlayerFacing = VectorMaskBits(VectorBitwiseAnd(VectorCompareGT(PlayerDot, Zero),
+				VectorCompareGT(VectorMultiply(PlayerDot, PlayerDot), MinDotSquared)));
+
+			const int LanesUsed = FMath::Min(4, NumPlayers - Lane);
+			for (int i = 0; i < LanesUsed; ++i)
+			{
+				const bool bMonsterFacing = (MonsterFacing >> i) & 1;
+				const bool bPlayerFacing = (PlayerFacing >> i) & 1;
+				AAbyssTunnelsCharacter* Player = Players[Lane + i];
+				if (!bMonsterFacing && !bPlayerFacing)
+				{
+					continue;
+				}
+				LastSightChecks++;
+				if (!UAbyssTunnelsGameplayStatics::HasLineOfSight(this, Monster->GetActorLocation(), Player->GetActorLocation()))
+				{
+					continue; // there is no seeing through walls
+				}
+				if (bMonsterFacing)
+				{
+					Monster->SeenCharacters.AddUnique(Player);
+				}
+				bIsSeenByPlayer |= bPlayerFacing;
+			}
+		}
+		Monster->bIsSeenByPlayer = bIsSeenByPlayer;
+		LastPairsChecked += NumPlayers;
+	}
+	NextMonsterId = Snapshot.Characters[MonsterOrder[(Cursor + MonstersThisFrame - 1) % NumMonsters]]->GetUniqueID() + 1;
+}
@@ -0,0 +1,47 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "PerceptionSubsystem.generated.h"
+
+class AAbyssTunnelsCharacter;
+
+/**
+ * Server side stealth perception for all monsters in one place. Each frame it takes the next monsters in a fixed
+ * round robin order, up to Abyss.Perception.PairsPerFrame monster/player pairs, and updates their bIsSeenByPlayer
+ * and SeenCharacters. The facing tests run four players at a time with SIMD over the character index's SoA data,
+ * and line of sight is only checked for pairs where someone is facing someone.
+ * While it is enabled AAbyssTunnelsCharacter::UpdatePlayerSeeing does nothing so blueprints calling it don't pay twice.
+ */
+UCLASS()
+class ABYSSTUNNELS_API UPerceptionSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+public:
+	static bool IsEnabled();
+
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+	virtual bool IsTickable() const override;
+
+	// how many pairs the last tick looked at and how many of those needed a line of sight check.
+	int GetLastPairsChecked() const { return LastPairsChecked; }
+	int GetLastSightChecks() const { return LastSightChecks; }
+
+protected:
+	// the players of this frame, padded with zeros to a multiple of four lanes.
+	TArray<float> PlayerX;
+	TArray<float> PlayerY;
+	TArray<float> PlayerZ;
+	TArray<float> PlayerForwardX;
+	TArray<float> PlayerForwardY;
+	TArray<float> PlayerForwardZ;
+	TArray<AAbyssTunnelsCharacter*> Players;
+	// monster snapshot entries in a stable order so the round robin cursor means the same thing every frame.
+	TArray<int32> MonsterOrder;
+	uint32 NextMonsterId = 0;
+	int LastPairsChecked = 0;
+	int LastSightChecks = 0;
+};
@@ -0,0 +1,26 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/Interface.h"
+#include "PoolableActor.generated.h"
+
+UINTERFACE(MinimalAPI, Blueprintable)
+class UPoolableActor : public UInterface
+{
+	GENERATED_BODY()
+};
+
+// optional hooks for actors handed out by UActorPoolComponent. anything a fresh spawn would set up
+// (state, timers, effects) should be reset in OnAcquiredFromPool.
+class ABYSSTUNNELS_API IPoolableActor
+{
+	GENERATED_BODY()
+public:
+	UFUNCTION(BlueprintNativeEvent, Category = "Abyss")
+	void OnAcquiredFromPool();
+
+	UFUNCTION(BlueprintNativeEvent, Category = "Abyss")
+	void OnReturnedToPool();
+};
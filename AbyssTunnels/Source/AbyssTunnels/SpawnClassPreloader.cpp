@@ -0,0 +1,189 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "SpawnClassPreloader.h"
+#include "BoardGenerator.h"
+#include "SpawnDataAsset.h"
+#include "AbyssTunnelsGameMode.h"
+#include "ActorPoolComponent.h"
+#include "Engine/AssetManager.h"
+#include "Engine/StreamableManager.h"
+
+USpawnClassPreloader* USpawnClassPreloader::Get(const UObject* WorldContextObject)
+{
+	if (const UWorld* World = GEngine->GetWorldFromContextObject(WorldContextObject, EGetWorldErrorMode::ReturnNull))
+	{
+		return World->GetSubsystem<USpawnClassPreloader>();
+	}
+	return nullptr;
+}
+
+void USpawnClassPreloader::CollectLevelClasses(const ABoardGenerator* Board, const int Level, TArray<FSoftObjectPath>& OutPaths)
+{
+	auto AddPath = [&OutPaths](const FSoftObjectPath& Path)
+	{
+		if (!Path.IsNull())
+		{
+			OutPaths.AddUnique(Path);
+		}
+	};
+	AddPath(Board->DoorClass.ToSoftObjectPath());
+	AddPath(Board->DoorFrameClass.ToSoftObjectPath());
+	AddPath(Board->ExitActorClass.ToSoftObjectPath());
+	for (const auto& Entry : Board->SpawnableMonsters)
+	{
+		if (Entry.Key <= Level)
+		{
+			AddPath(Entry.Value.ToSoftObjectPath());
+		}
+	}
+	if (Board->SpawnDataAsset)
+	{
+		for (const FSpawnTableEntry& Entry : Board->SpawnDataAsset->SpawnTable)
+		{
+			if (Entry.MinimumLevel <= Level && Entry.MaximumLevel >= Level)
+			{
+				AddPath(Entry.SpawnableObjectClass.ToSoftObjectPath());
+			}
+		}
+	}
+}
+
+void USpawnClassPreloader::SetReachableLevels(const ABoardGenerator* Board, const TArray<int>& Levels)
+{
+	if (!Board)
+	{
+		return;
+	}
+	// boards that went away without releasing.
+	for (auto It = BoardBands.CreateIterator(); It; ++It)
+	{
+		if (!It.Key().IsValid())
+		{
+			for (auto& Entry : It.Value())
+			{
+				ReleaseBand(Entry.Value, PendingTrimPaths);
+			}
+			It.RemoveCurrent();
+		}
+	}
+	TMap<int, FPreloadedBand>& LevelBands = BoardBands.FindOrAdd(Board);
+	// releasing first is fine, classes shared with a band that stays are still held by that band's handle.
+	for (auto It = LevelBands.CreateIterator(); It; ++It)
+	{
+		if (!Levels.Contains(It.Key()))
+		{
+			ReleaseBand(It.Value(), PendingTrimPaths);
+			It.RemoveCurrent();
+		}
+	}
+	for (const int Level : Levels)
+	{
+		if (LevelBands.Contains(Level))
+		{
+			continue;
+		}
+		FPreloadedBand& Band = LevelBands.Add(Level);
+		CollectLevelClasses(Board, Level, Band.Paths);
+		const double StartTime = FPlatformTime::Seconds();
+		const int NumClasses = Band.Paths.Num();
+		Band.Handle = UAssetManager::GetStreamableManager().RequestAsyncLoad(Band.Paths,
+			FStreamableDelegate::CreateLambda([Level, NumClasses, StartTime]()
+			{
+				UE_LOG(LogTemp, Log, TEXT("Preloaded %d spawnable classes for level %d in %.1f ms"), NumClasses, Level, (FPlatformTime::Seconds() - StartTime) * 1000.0);
+			}));
+	}
+	// after the new bands went in, so a class the next level needs again keeps its pooled actors.
+	TrimActorPool(PendingTrimPaths);
+	PendingTrimPaths.Reset();
+}
+
+void USpawnClassPreloader::ReleaseBoard(const ABoardGenerator* Board)
+{
+	TMap<int, FPreloadedBand> LevelBands;
+	if (!BoardBands.RemoveAndCopyValue(Board, LevelBands))
+	{
+		return;
+	}
+	// no trimming here. the game mode destroys the old board before spawning the next one, so right now nobody holds
+	// anything and the doors and items that were just pooled would all go. the next board's first request trims.
+	for (auto& Entry : LevelBands)
+	{
+		ReleaseBand(Entry.Value, PendingTrimPaths);
+	}
+}
+
+void USpawnClassPreloader::ReleaseBand(FPreloadedBand& Band, TArray<FSoftObjectPath>& OutReleasedPaths)
+{
+	if (Band.Handle.IsValid())
+	{
+		Band.Handle->ReleaseHandle();
+		Band.Handle.Reset();
+	}
+	for (const FSoftObjectPath& Path : Band.Paths)
+	{
+		OutReleasedPaths.AddUnique(Path);
+	}
+}
+
+void USpawnClassPreloader::TrimActorPool(const TArray<FSoftObjectPath>& ReleasedPaths) const
+{
+	const UWorld* World = GetWorld();
+	const AAbyssTunnelsGameMode* GameMode = World ? World->GetAuthGameMode<AAbyssTunnelsGameMode>() : nullptr;
+	// no pool on clients.
+	if (!GameMode || !GameMode->ActorPool || ReleasedPaths.Num() == 0)
+	{
+		return;
+	}
+	TSet<FSoftObjectPath> HeldPaths;
+	for (const auto& BoardEntry : BoardBands)
+	{
+		for (const auto& BandEntry : BoardEntry.Value)
+		{
+			HeldPaths.Append(BandEntry.Value.Paths);
+		}
+	}
+	for (const FSoftObjectPath& Path : ReleasedPaths)
+	{
+		// a class that isn't loaded can't have anything pooled.
+		UClass* Class = HeldPaths.Contains(Path) ? nullptr : Cast<UClass>(Path.ResolveObject());
+		if (Class)
+		{
+			GameMode->ActorPool->EmptyPoolOfClass(Class);
+		}
+	}
+}
+
+void USpawnClassPreloader::WaitForLevel(const ABoardGenerator* Board, const int Level)
+{
+	const TMap<int, FPreloadedBand>* LevelBands = BoardBands.Find(Board);
+	const FPreloadedBand* Band = LevelBands ? LevelBands->Find(Level) : nullptr;
+	if (Band && Band->Handle.IsValid() && Band->Handle->IsLoadingInProgress())
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Level %d started before its spawnable classes finished loading, waiting on them"), Level);
+		Band->Handle->WaitUntilComplete();
+	}
+}
+
+bool USpawnClassPreloader::IsLevelLoaded(const ABoardGenerator* Board, const int Level) const
+{
+	const TMap<int, FPreloadedBand>* LevelBands = BoardBands.Find(Board);
+	const FPreloadedBand* Band = LevelBands ? LevelBands->Find(Level) : nullptr;
+	return Band && (!Band->Handle.IsValid() || Band->Handle->HasLoadCompleted());
+}
+
+void USpawnClassPreloader::Deinitialize()
+{
+	// the pool goes with the game mode, nothing to trim.
+	TArray<FSoftObjectPath> ReleasedPaths;
+	for (auto& BoardEntry : BoardBands)
+	{
+		for (auto& BandEntry : BoardEntry.Value)
+		{
+			ReleaseBand(BandEntry.Value, ReleasedPaths);
+		}
+	}
+	BoardBands.Empty();
+	PendingTrimPaths.Empty();
+	Super::Deinitialize();
+}
@@ -0,0 +1,65 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "UObject/SoftObjectPath.h"
+#include "SpawnClassPreloader.generated.h"
+
+class ABoardGenerator;
+struct FStreamableHandle;
+
+struct FPreloadedBand
+{
+	// null when the band had nothing left to load when it was requested.
+	TSharedPtr<FStreamableHandle> Handle;
+	TArray<FSoftObjectPath> Paths;
+};
+
+/**
+ * Streams in the spawnable classes a level needs before the level starts, so the first spawn of each doesn't hitch.
+ * A level's band is every spawn table entry whose MinimumLevel..MaximumLevel covers it, every monster whose minimum
+ * level is at or below it, and the door, door frame and exit classes. The board keeps the current and predicted next
+ * level requested; bands of any other level are released so their classes can be garbage collected. Bands are held
+ * per requesting board, so another board in the same world (or a board going away) never drops the ones a live
+ * board still needs. Once a class isn't in any band anymore the server also empties the actor pool of it, otherwise the
+ * pooled instances would keep it loaded. Runs on server and clients alike since replicated actors need their class
+ * loaded on both sides.
+ */
+UCLASS()
+class ABYSSTUNNELS_API USpawnClassPreloader : public UWorldSubsystem
+{
+	GENERATED_BODY()
+public:
+	static USpawnClassPreloader* Get(const UObject* WorldContextObject);
+
+	// starts loading the band of each level in Levels that Board doesn't have loaded or loading already and releases
+	// all other bands Board holds.
+	void SetReachableLevels(const ABoardGenerator* Board, const TArray<int>& Levels);
+
+	// drops every band Board holds. the board calls this when it ends play. the pool is only trimmed of their classes
+	// once a board requests bands again, so a board handing over to the next one doesn't empty it.
+	void ReleaseBoard(const ABoardGenerator* Board);
+
+	// blocks until Board's band of Level is in. normally a no-op, only the very first level has nobody loading ahead of it.
+	void WaitForLevel(const ABoardGenerator* Board, const int Level);
+
+	bool IsLevelLoaded(const ABoardGenerator* Board, const int Level) const;
+
+	static void CollectLevelClasses(const ABoardGenerator* Board, const int Level, TArray<FSoftObjectPath>& OutPaths);
+
+	virtual void Deinitialize() override;
+
+protected:
+	static void ReleaseBand(FPreloadedBand& Band, TArray<FSoftObjectPath>& OutReleasedPaths);
+
+	// empties the actor pool of every released class no band holds anymore.
+	void TrimActorPool(const TArray<FSoftObjectPath>& ReleasedPaths) const;
+
+	// per board, level -> band.
+	TMap<TWeakObjectPtr<const ABoardGenerator>, TMap<int, FPreloadedBand>> BoardBands;
+
+	// classes of released bands, trimmed from the pool on the next SetReachableLevels.
+	TArray<FSoftObjectPath> PendingTrimPaths;
+};
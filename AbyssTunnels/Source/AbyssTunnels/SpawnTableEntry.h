@@ -11,8 +11,9 @@ USTRUCT(BlueprintType)
 struct ABYSSTUNNELS_API FSpawnTableEntry
 {
 	GENERATED_BODY()
+	// soft so it only gets loaded for the levels it can spawn on, see USpawnClassPreloader.
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Abyss")
-	TSubclassOf<ASpawnableObject> SpawnableObjectClass;
+	TSoftClassPtr<ASpawnableObject> SpawnableObjectClass;
 	
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Abyss")
 	float SpawnChance = 0.3;
@@ -2,6 +2,7 @@
 
 
 #include "SpawnableObject.h"
+#include "Components/PrimitiveComponent.h"
 
 
 // Sets default values
@@ -11,3 +12,36 @@ ASpawnableObject::ASpawnableObject()
 	PrimaryActorTick.bCanEverTick = false;
 	bReplicates = true;
 }
+
+void ASpawnableObject::OnAcquiredFromPool_Implementation()
+{
+	TInlineComponentArray<UPrimitiveComponent*> Primitives(this);
+	for (UPrimitiveComponent* Primitive : Primitives)
+	{
+		// the archetype is the component as the class (or its blueprint) sets it up.
+		const UPrimitiveComponent* Template = Cast<UPrimitiveComponent>(Primitive->GetArchetype());
+		if (!Template)
+		{
+			continue;
+		}
+		Primitive->SetCollisionEnabled(Template->GetCollisionEnabled());
+		Primitive->SetVisibility(Template->GetVisibleFlag());
+		Primitive->SetHiddenInGame(Template->bHiddenInGame);
+		Primitive->SetSimulatePhysics(Template->BodyInstance.bSimulatePhysics);
+		if (Primitive->IsSimulatingPhysics())
+		{
+			Primitive->SetPhysicsLinearVelocity(FVector::ZeroVector);
+			Primitive->SetPhysicsAngularVelocityInDegrees(FVector::ZeroVector);
+		}
+	}
+}
+
+void ASpawnableObject::OnReturnedToPool_Implementation()
+{
+	// nothing should fall or roll around while it sits hidden in the pool.
+	TInlineComponentArray<UPrimitiveComponent*> Primitives(this);
+	for (UPrimitiveComponent* Primitive : Primitives)
+	{
+		Primitive->SetSimulatePhysics(false);
+	}
+}
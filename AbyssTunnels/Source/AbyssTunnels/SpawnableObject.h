@@ -4,12 +4,13 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/Actor.h"
+#include "PoolableActor.h"
 #include "SpawnableObject.generated.h"
 
 class AAbyssTunnelsPlayerController;
 
 UCLASS()
-class ABYSSTUNNELS_API ASpawnableObject : public AActor
+class ABYSSTUNNELS_API ASpawnableObject : public AActor, public IPoolableActor
 {
 	GENERATED_BODY()
 
@@ -19,4 +20,9 @@ public:
 
 	UFUNCTION(BlueprintImplementableEvent, BlueprintCallable, Category = "Abyss")
 	void Interaction(AAbyssTunnelsPlayerController* PlayerController);
+
+	// items come back from the pool the way they were placed: physics, collision and visibility of every primitive
+	// as the class sets them up. blueprints that override these should call the parent.
+	virtual void OnAcquiredFromPool_Implementation() override;
+	virtual void OnReturnedToPool_Implementation() override;
 };
@@ -1,6 +1,7 @@
 #include "TriggerSpace.h"
 #include "AbyssTunnelsCharacter.h"
 #include "AbyssTunnelsGameState.h"
+#include "CharacterIndexSubsystem.h"
 
 
 // Sets default values
@@ -26,27 +27,10 @@ void ATriggerSpace::OnCharacterOverlapped(AAbyssTunnelsCharacter* Character)
 
 bool ATriggerSpace::AreAllCharactersPresent() const
 {
-	if (UWorld* World = GetWorld())
-	{	
-		int PlayersCounted = 0;
-		for (FConstPlayerControllerIterator Iterator = World->GetPlayerControllerIterator(); Iterator; ++Iterator)
-		{
-			APlayerController* PlayerController = Iterator->Get();
-			if (PlayerController == nullptr || PlayerController->Player == nullptr)
-			{
-				continue;
-			}
-
-			if (APawn* Pawn = PlayerController->GetPawn())
-			{
-				PlayersCounted++;
-				if (FVector::Distance(Pawn->GetActorLocation(), this->GetActorLocation()) > GroupTriggerDistance)
-				{
-					return false;
-				}
-			}
-		}
-		return PlayersCounted > 0;
+	if (UCharacterIndexSubsystem* CharacterIndex = UCharacterIndexSubsystem::Get(this))
+	{
+		const int PlayersCounted = CharacterIndex->GetSnapshot().PlayerEntries.Num();
+		return PlayersCounted > 0 && CharacterIndex->CountInRadius(GetActorLocation(), GroupTriggerDistance, ECharacterIndexFilter::Players) == PlayersCounted;
 	}
 	return false;
 }